@@ -0,0 +1,108 @@
+// 1M inserts then 1M lookups into a dict and into std::unordered_map, with random 63 bit integer keys and with
+// distinct string keys. build with 'cmake --build <dir> --target dict_bench', prints the best of three rounds in ms
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <skai/object.hpp>
+
+namespace {
+using clock_type = std::chrono::steady_clock;
+using skai::object::value;
+
+constexpr std::size_t count = 1000000;
+constexpr int rounds = 3;
+
+struct timings {
+    double insert = 1e300;
+    double lookup = 1e300;
+};
+
+double elapsed(clock_type::time_point since) {
+    return std::chrono::duration<double, std::milli>(clock_type::now() - since).count();
+}
+
+// inserts every key, then looks every key up. 'set' and 'get' adapt the container, the sum of the values found keeps
+// the lookups from being optimized away
+template <class Key, class Set, class Get>
+timings measure(const std::vector<Key>& keys, Set set, Get get) {
+    timings best;
+    for (int round = 0; round < rounds; ++round) {
+        auto start = clock_type::now();
+        auto table = set(keys);
+        auto insert = elapsed(start);
+        start = clock_type::now();
+        std::int64_t sum = get(table, keys);
+        auto lookup = elapsed(start);
+        if (sum != static_cast<std::int64_t>(count * (count - 1) / 2)) fmt::print(stderr, "wrong sum {}\n", sum);
+        best.insert = std::min(best.insert, insert);
+        best.lookup = std::min(best.lookup, lookup);
+    }
+    return best;
+}
+
+template <class Key>
+timings dict(const std::vector<Key>& keys) {
+    return measure(
+        keys,
+        [](const std::vector<Key>& ks) {
+            auto d = skai::object::make<skai::object::dict>();
+            for (std::size_t i = 0; i < ks.size(); ++i) d->set(ks[i], value::integer(static_cast<std::int64_t>(i)));
+            return d;
+        },
+        [](const auto& d, const std::vector<Key>& ks) {
+            std::int64_t sum = 0;
+            for (const auto& k : ks) sum += d->find(k)->as_int();
+            return sum;
+        });
+}
+
+template <class Key>
+timings unordered_map(const std::vector<Key>& keys) {
+    return measure(
+        keys,
+        [](const std::vector<Key>& ks) {
+            std::unordered_map<Key, value> m;
+            for (std::size_t i = 0; i < ks.size(); ++i) m[ks[i]] = value::integer(static_cast<std::int64_t>(i));
+            return m;
+        },
+        [](const auto& m, const std::vector<Key>& ks) {
+            std::int64_t sum = 0;
+            for (const auto& k : ks) sum += m.find(k)->second.as_int();
+            return sum;
+        });
+}
+
+void report(const char* name, timings t) {
+    fmt::print("{:<20} insert {:7.1f}  lookup {:7.1f}\n", name, t.insert, t.lookup);
+}
+}  // namespace
+
+int main() {
+    // xorshift, the keys are the same on every run
+    std::vector<std::int64_t> ints(count);
+    std::uint64_t state = 88172645463325252ull;
+    for (auto& k : ints) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        k = static_cast<std::int64_t>(state >> 1);
+    }
+    std::vector<value> int_keys;
+    std::vector<value> string_keys;
+    std::vector<std::string> strings;
+    for (std::size_t i = 0; i < count; ++i) {
+        int_keys.push_back(value::integer(ints[i]));
+        strings.push_back("key" + std::to_string(i));
+        string_keys.push_back(skai::object::make<skai::object::string>(strings.back()));
+    }
+    report("int dict", dict(int_keys));
+    report("int unordered_map", unordered_map(ints));
+    report("string dict", dict(string_keys));
+    report("string unordered_map", unordered_map(strings));
+}
@@ -3,284 +3,503 @@
 #include <fmt/format.h>
 
 #include <cstdint>
-#include <memory>
+#include <deque>
+#include <new>
 #include <string>
+#include <string_view>
 #include <type_traits>
+#include <unordered_map>
+#include <vector>
 
+#include "error.hpp"
 #include "lexer.hpp"
 namespace skai {
-struct expr {
-    virtual std::string debug() const = 0;
-    virtual ~expr() = default;
+// where a name lives at runtime, filled in by the resolver. 'slot' indexes the global table, the locals of the current
+// frame or the upvalues of the running closure. locals captured by a nested function are boxed in a cell which the
+// frame and the closures share
+struct binding {
+    enum class storage : std::uint8_t { global, local, cell, upvalue };
+    storage where = storage::global;
+    std::uint32_t slot = 0;
 };
-struct assign_expr : expr {
-    std::shared_ptr<expr> lhs;
-    std::shared_ptr<expr> rhs;
 
-    assign_expr(std::shared_ptr<expr> lhs, std::shared_ptr<expr> rhs) : lhs{(lhs)}, rhs{(rhs)} {}
-
-    std::string debug() const override {
-        return fmt::format("assgin(left={}, right{})", lhs->debug(), rhs->debug());
-    }
+// how a closure gets hold of one of its upvalues when it is created: a boxed local of the enclosing frame or one of
+// the upvalues of the enclosing closure
+struct capture {
+    bool is_local;
+    std::uint32_t index;
 };
 
-struct binary_expr : expr {
-    std::shared_ptr<expr> lhs;
-    token op;
-    std::shared_ptr<expr> rhs;
+enum class node_kind : std::uint8_t {
+    null,
+    assign,
+    binary,
+    logical,
+    unary,
+    bool_,
+    return_,
+    num,
+    array,
+    ldouble,
+    string,
+    break_,
+    continue_,
+    self,
+    variable,
+    ident,
+    if_,
+    call,
+    argument,
+    function,
+    for_,
+    while_,
+    class_,
+    access,
+    block,
+    subscript,
+    interpolation,
+    slice,
+    dict,
+    lambda,
+    range,
+    iterate,
+};
 
-    binary_expr(std::shared_ptr<expr> lhs, token t, std::shared_ptr<expr> rhs) : lhs{(lhs)}, op{t}, rhs{(rhs)} {}
+// nodes live in the arena of their 'ast' and refer to each other by offset, 0 is the null node
+using node_ref = std::uint32_t;
+// index into the string table of the 'ast', identifiers and string literals are stored once
+using str_ref = std::uint32_t;
+// a run of node references (or captures) in one of the side tables of the 'ast'
+struct list_ref {
+    std::uint32_t first = 0;
+    std::uint32_t size = 0;
+};
 
-    std::string debug() const override {
-        return fmt::format("binary(left={}, operator={}, right={})", lhs->debug(), op, rhs->debug());
-    }
+// every node starts with its kind so that the backends can switch on it, nodes are trivially copyable and the arena
+// frees them all at once
+struct null_expr {
+    static constexpr node_kind tag = node_kind::null;
+    node_kind kind;
+};
+struct assign_expr {
+    static constexpr node_kind tag = node_kind::assign;
+    node_kind kind;
+    node_ref lhs;
+    node_ref rhs;
+    binding bind{};
 };
-struct logical_expr : expr {
-    std::shared_ptr<expr> lhs;
+struct binary_expr {
+    static constexpr node_kind tag = node_kind::binary;
+    node_kind kind;
     token op;
-    std::shared_ptr<expr> rhs;
-
-    logical_expr(std::shared_ptr<expr> lhs, token t, std::shared_ptr<expr> rhs) : lhs{(lhs)}, op{t}, rhs{(rhs)} {}
-    std::string debug() const override {
-        return fmt::format("logical(left={}, operand={}, right={})", lhs->debug(), op, rhs->debug());
-    }
+    node_ref lhs;
+    node_ref rhs;
 };
-struct unary_expr : expr {
+struct logical_expr {
+    static constexpr node_kind tag = node_kind::logical;
+    node_kind kind;
     token op;
-    std::shared_ptr<expr> operand;
-
-    unary_expr(token t, std::shared_ptr<expr> opr) : op{t}, operand{(opr)} {}
-
-    std::string debug() const override {
-        return fmt::format("unary(operator={}, operand={})", op, operand->debug());
-    }
+    node_ref lhs;
+    node_ref rhs;
 };
-struct bool_expr : expr {
+struct unary_expr {
+    static constexpr node_kind tag = node_kind::unary;
+    node_kind kind;
+    token op;
+    node_ref operand;
+};
+struct bool_expr {
+    static constexpr node_kind tag = node_kind::bool_;
+    node_kind kind;
     bool value;
-    bool_expr(bool x) : value{x} {}
-    bool_expr(token tok) : value{tok == token::true_ ? true : false} {}
-
-    std::string debug() const override {
-        return fmt::format("bool({})", value);
-    }
 };
-struct return_stmt : expr {
-    std::shared_ptr<expr> value;
-    return_stmt(std::shared_ptr<expr> v) : value{(v)} {}
-
-    std::string debug() const override {
-        return fmt::format("return({})", value->debug());
-    }
+struct return_stmt {
+    static constexpr node_kind tag = node_kind::return_;
+    node_kind kind;
+    node_ref value;
 };
-struct num_expr : expr {
+struct num_expr {
+    static constexpr node_kind tag = node_kind::num;
+    node_kind kind;
     std::int64_t value;
-    num_expr(const std::string& value) : value{std::stoll(value)} {}
-    num_expr(std::int64_t value) : value{value} {}
-
-    std::string debug() const override {
-        return fmt::format("number({})", value);
-    }
 };
-struct array_expr : expr {
-    std::vector<std::shared_ptr<expr>> elements;
-    array_expr(const std::vector<std::shared_ptr<expr>>& e) : elements{e} {}
-    std::string debug() const override {
-        std::string str{"<"};
-        for (std::size_t i = 0; i < elements.size(); ++i) {
-            str.append(elements.at(i)->debug());
-            if (i != elements.size() - 1) str.push_back(',');
-        }
-        str.push_back('>');
-        return fmt::format("array({})'", str);
-    }
+struct array_expr {
+    static constexpr node_kind tag = node_kind::array;
+    node_kind kind;
+    list_ref elements;
 };
-struct ldouble_expr : expr {
-    long double value;
-    ldouble_expr(const std::string& value) : value{std::stold(value)} {}
-    ldouble_expr(long double value) : value{value} {}
-
-    std::string debug() const override {
-        return fmt::format("float({})", value);
-    }
+struct ldouble_expr {
+    static constexpr node_kind tag = node_kind::ldouble;
+    node_kind kind;
+    double value;
 };
-struct string_expr : expr {
-    std::string value;
-    string_expr(const std::string& val) : value{val} {}
-
-    std::string debug() const override {
-        return fmt::format("string(\"{}\")", value);
-    }
+struct string_expr {
+    static constexpr node_kind tag = node_kind::string;
+    node_kind kind;
+    str_ref value;
 };
-struct null_expr : expr {
-    std::string debug() const override {
-        return "null";
-    }
+// "a${x}b", the parts are the pieces of text (as string nodes, empty ones are left out) and the expressions in order
+struct interpolation_expr {
+    static constexpr node_kind tag = node_kind::interpolation;
+    node_kind kind;
+    list_ref parts;
 };
-struct break_stmt : expr {
-    std::string debug() const override {
-        return "break";
-    }
+struct break_stmt {
+    static constexpr node_kind tag = node_kind::break_;
+    node_kind kind;
 };
-struct continue_stmt : expr {
-    std::string debug() const override {
-        return "continue";
-    }
+struct continue_stmt {
+    static constexpr node_kind tag = node_kind::continue_;
+    node_kind kind;
 };
-struct self_expr : expr {
-    std::string debug() const override {
-        return "self";
-    }
+struct self_expr {
+    static constexpr node_kind tag = node_kind::self;
+    node_kind kind;
 };
-struct variable_expr : expr {
-    std::string name;
-    std::shared_ptr<expr> value;
+struct variable_expr {
+    static constexpr node_kind tag = node_kind::variable;
+    node_kind kind;
+    str_ref name;
+    node_ref value;
     bool is_const;
-    variable_expr(const std::string& val, std::shared_ptr<expr> v, bool i_c) : name{val}, value{(v)}, is_const{i_c} {}
-
-    std::string debug() const override {
-        return fmt::format("variable(name={}, value={})", name, value->debug());
-    }
+    binding bind{};
 };
-struct ident_expr : expr {
-    std::string name;
-    ident_expr(const std::string& val) : name{val} {}
-    std::string debug() const override {
-        return fmt::format("identifier({})", name);
-    }
+struct ident_expr {
+    static constexpr node_kind tag = node_kind::ident;
+    node_kind kind;
+    str_ref name;
+    binding bind{};
 };
-struct if_stmt : expr {
-    std::shared_ptr<expr> condition;
-    std::shared_ptr<expr> init;
-    std::shared_ptr<expr> then_branch;
-    std::shared_ptr<expr> else_branch;
-    if_stmt(const std::shared_ptr<expr>& i, std::shared_ptr<expr> c, std::shared_ptr<expr> t, std::shared_ptr<expr> e)
-        : condition{(c)}, init{i}, then_branch{(t)}, else_branch{(e)} {}
-
-    std::string debug() const override {
-        return fmt::format("if(confition={}, then={}, else={})", condition->debug(), then_branch->debug(),
-                           (else_branch ? else_branch->debug() : "null"));
-    }
+struct if_stmt {
+    static constexpr node_kind tag = node_kind::if_;
+    node_kind kind;
+    node_ref init;
+    node_ref condition;
+    node_ref then_branch;
+    node_ref else_branch;
 };
-struct call_expr : expr {
-    std::shared_ptr<expr> callee;
-    std::vector<std::shared_ptr<expr>> arguments;
-    call_expr(std::shared_ptr<expr> c, std::vector<std::shared_ptr<expr>> a) : callee{(c)}, arguments{(a)} {}
-
-    std::string debug() const override {
-        std::string str{};
-        if (arguments.size() == 0)
-            str = "null";
-        else
-            for (auto& u : arguments) (str += u->debug()) += ',';
-        return fmt::format("call(callee={}, arguments={})", callee->debug(), str);
-    }
+struct call_expr {
+    static constexpr node_kind tag = node_kind::call;
+    node_kind kind;
+    node_ref callee;
+    list_ref arguments;
+};
+struct argument_expr {
+    static constexpr node_kind tag = node_kind::argument;
+    node_kind kind;
+    str_ref name;
+    node_ref def;
+    binding bind{};
+};
+struct function_stmt {
+    static constexpr node_kind tag = node_kind::function;
+    node_kind kind;
+    str_ref name;
+    list_ref arguments;
+    list_ref body;
+    binding bind{};
+    // number of slots a call frame needs, arguments come first
+    std::uint32_t slots = 0;
+    list_ref captures{};
+};
+struct for_stmt {
+    static constexpr node_kind tag = node_kind::for_;
+    node_kind kind;
+    node_ref init;
+    node_ref condition;
+    node_ref branch;
+    node_ref body;
+};
+struct while_stmt {
+    static constexpr node_kind tag = node_kind::while_;
+    node_kind kind;
+    node_ref init;
+    node_ref branch;
+    node_ref body;
+};
+struct class_expr {
+    static constexpr node_kind tag = node_kind::class_;
+    node_kind kind;
+    str_ref name;
+    list_ref members;
+};
+struct access_expr {
+    static constexpr node_kind tag = node_kind::access;
+    node_kind kind;
+    node_ref target;
+    node_ref object;
+};
+struct block_stmt {
+    static constexpr node_kind tag = node_kind::block;
+    node_kind kind;
+    list_ref stmts;
+};
+struct subscript_expr {
+    static constexpr node_kind tag = node_kind::subscript;
+    node_kind kind;
+    node_ref object;
+    node_ref target;
+};
+// 'object[begin:end]', an omitted bound is 0
+struct slice_expr {
+    static constexpr node_kind tag = node_kind::slice;
+    node_kind kind;
+    node_ref object;
+    node_ref begin;
+    node_ref end;
 };
-struct argument_expr : expr {
-    std::string name;
-    std::shared_ptr<expr> def;
-
-    argument_expr(const std::string& name, const std::shared_ptr<expr>& d) : name{name}, def{d} {}
 
-    std::string debug() const override {
-        return fmt::format("argument(name={}, default={})", name, def ? def->debug() : "null");
-    }
+// '{k: v, ...}', the keys and values alternate in 'entries'
+struct dict_expr {
+    static constexpr node_kind tag = node_kind::dict;
+    node_kind kind;
+    list_ref entries;
 };
-struct function_stmt : expr {
-    std::string name;
-    std::vector<std::shared_ptr<argument_expr>> arguments;
-    std::vector<std::shared_ptr<expr>> body;
 
-    function_stmt(const std::string& n, std::vector<std::shared_ptr<argument_expr>> a,
-                  std::vector<std::shared_ptr<expr>> b)
-        : name{n}, arguments{a}, body{b} {}
+// 'lm x, y -> expr', wraps a function named 'lambda' whose body returns the expression
+struct lambda_expr {
+    static constexpr node_kind tag = node_kind::lambda;
+    node_kind kind;
+    node_ref function;
+};
 
-    std::string debug() const override {
-        std::string args{};
-        std::string bodystr{};
-        for (auto& arg : arguments) (args += arg->debug()) += ',';
-        for (auto& stmt : body) (bodystr += stmt->debug()) += ',';
-        return fmt::format("fnc(name={}, arguments={}, body={})", name, args.size() > 0 ? args : "null", bodystr);
-    }
+// 'begin..end' or 'begin..end..step', an omitted step is 0
+struct range_expr {
+    static constexpr node_kind tag = node_kind::range;
+    node_kind kind;
+    node_ref begin;
+    node_ref end;
+    node_ref step;
+};
+// 'for name of iterable body', the variable is overwritten by every element
+struct iterate_stmt {
+    static constexpr node_kind tag = node_kind::iterate;
+    node_kind kind;
+    str_ref name;
+    node_ref iterable;
+    node_ref body;
+    binding bind{};
 };
-struct for_stmt : expr {
-    std::shared_ptr<expr> init;
-    std::shared_ptr<expr> condition;
-    std::shared_ptr<expr> branch;
-    std::shared_ptr<expr> body;
 
-    for_stmt(std::shared_ptr<expr> i, std::shared_ptr<expr> c, std::shared_ptr<expr> b, std::shared_ptr<expr> o)
-        : init{i}, condition{c}, branch{b}, body{o} {}
+// contiguous range of a side table, only valid until the table grows
+template <class T>
+struct list_view {
+    const T* first;
+    const T* last;
 
-    std::string debug() const override {
-        return fmt::format("for(init={}, condition={}, branch={}, body={})", init->debug(), condition->debug(),
-                           body->debug(), branch->debug());
+    const T* begin() const {
+        return first;
+    }
+    const T* end() const {
+        return last;
+    }
+    std::size_t size() const {
+        return static_cast<std::size_t>(last - first);
+    }
+    const T& operator[](std::size_t i) const {
+        return first[i];
     }
 };
-struct while_stmt : expr {
-    std::shared_ptr<expr> init;
-    std::shared_ptr<expr> branch;
-    std::shared_ptr<expr> body;
 
-    while_stmt(const std::shared_ptr<expr>& i, std::shared_ptr<expr> b, std::shared_ptr<expr> o)
-        : init{i}, branch{(b)}, body{(o)} {}
-
-    std::string debug() const override {
-        return fmt::format("while(condition={}, body={})", branch->debug(), body->debug());
+// owns every node of a parsed program. nodes are bump allocated into 8 byte words and addressed by their offset, so a
+// child reference is 32 bits and the whole tree goes away with the arena. references returned by 'get' are invalidated
+// when a node is added
+struct ast {
+    ast() : m_words(1) {
+        new (m_words.data()) null_expr{node_kind::null};
+    }
+    // the string index points into the stored strings, moving keeps them in place but copying wouldn't
+    ast(ast&&) = default;
+    ast& operator=(ast&&) = default;
+    ast(const ast&) = delete;
+    ast& operator=(const ast&) = delete;
+
+    template <class T, class... Args>
+    node_ref make(Args... args) {
+        static_assert(std::is_trivially_copyable_v<T> && alignof(T) <= alignof(std::uint64_t),
+                      "ast nodes are copied around as raw words");
+        auto ref = m_words.size();
+        if (ref + (sizeof(T) + 7) / 8 > UINT32_MAX) throw skai::exception{"program too large"};
+        m_words.resize(ref + (sizeof(T) + 7) / 8);
+        new (&m_words[ref]) T{T::tag, args...};
+        return static_cast<node_ref>(ref);
     }
-};
-struct class_expr : expr {
-    std::string name;
-    std::vector<std::shared_ptr<expr>> members;
 
-    class_expr(const std::string& n, const std::vector<std::shared_ptr<expr>>& m) : name{n}, members{m} {}
-    std::string debug() const override {
-        return fmt::format("class({})", name);
+    node_kind kind(node_ref ref) const {
+        return *std::launder(reinterpret_cast<const node_kind*>(&m_words[ref]));
+    }
+    template <class T>
+    T& get(node_ref ref) {
+        return *std::launder(reinterpret_cast<T*>(&m_words[ref]));
+    }
+    template <class T>
+    const T& get(node_ref ref) const {
+        return *std::launder(reinterpret_cast<const T*>(&m_words[ref]));
     }
-};
-struct access_expr : expr {
-    std::shared_ptr<expr> target;
-    std::shared_ptr<expr> object;
 
-    access_expr(const std::shared_ptr<expr>& t, const std::shared_ptr<expr>& e) : target{t}, object{e} {}
+    list_ref list(const node_ref* refs, std::size_t size) {
+        list_ref l{static_cast<std::uint32_t>(m_lists.size()), static_cast<std::uint32_t>(size)};
+        m_lists.insert(m_lists.end(), refs, refs + size);
+        return l;
+    }
+    void reserve(std::size_t words) {
+        m_words.reserve(words);
+    }
+    list_view<node_ref> nodes(list_ref l) const {
+        return {m_lists.data() + l.first, m_lists.data() + l.first + l.size};
+    }
 
-    std::string debug() const override {
-        return fmt::format("access(target={}, sub={})", target->debug(), object->debug());
+    list_ref add_captures(const std::vector<capture>& caps) {
+        list_ref l{static_cast<std::uint32_t>(m_captures.size()), static_cast<std::uint32_t>(caps.size())};
+        m_captures.insert(m_captures.end(), caps.begin(), caps.end());
+        return l;
+    }
+    list_view<capture> captures(list_ref l) const {
+        return {m_captures.data() + l.first, m_captures.data() + l.first + l.size};
     }
-};
 
-struct block_stmt : expr {
-    std::vector<std::shared_ptr<expr>> stmts;
-    block_stmt(std::vector<std::shared_ptr<expr>> s) : stmts{(s)} {}
+    str_ref intern(std::string_view s) {
+        if (auto it = m_string_index.find(s); it != m_string_index.end()) return it->second;
+        // the index refers to the stored copy, deque elements never move
+        const auto& stored = m_strings.emplace_back(s);
+        return m_string_index[stored] = static_cast<str_ref>(m_strings.size() - 1);
+    }
+    const std::string& str(str_ref ref) const {
+        return m_strings[ref];
+    }
 
-    std::string debug() const override {
-        std::string out{};
-        for (auto& stmt : stmts) { (out += stmt->debug()) += ';'; }
-        return out.size() > 0 ? out : "empty";
+    // arena footprint in bytes, nodes plus side tables
+    std::size_t bytes() const {
+        return m_words.size() * sizeof(std::uint64_t) + m_lists.size() * sizeof(node_ref) +
+               m_captures.size() * sizeof(capture);
     }
-};
-struct range_expr : expr {
-    long double min_;
-    long double max_;
-    std::string debug() const override {
-        return fmt::format("range(min={}, max={})", min_, max_);
+
+    std::string debug(node_ref ref) const {
+        switch (kind(ref)) {
+            case node_kind::null:
+                return "null";
+            case node_kind::assign: {
+                const auto& n = get<assign_expr>(ref);
+                return fmt::format("assgin(left={}, right{})", debug(n.lhs), debug(n.rhs));
+            }
+            case node_kind::binary: {
+                const auto& n = get<binary_expr>(ref);
+                return fmt::format("binary(left={}, operator={}, right={})", debug(n.lhs), token_str(n.op),
+                                   debug(n.rhs));
+            }
+            case node_kind::logical: {
+                const auto& n = get<logical_expr>(ref);
+                return fmt::format("logical(left={}, operand={}, right={})", debug(n.lhs), token_str(n.op),
+                                   debug(n.rhs));
+            }
+            case node_kind::unary: {
+                const auto& n = get<unary_expr>(ref);
+                return fmt::format("unary(operator={}, operand={})", token_str(n.op), debug(n.operand));
+            }
+            case node_kind::bool_:
+                return fmt::format("bool({})", get<bool_expr>(ref).value);
+            case node_kind::return_:
+                return fmt::format("return({})", debug(get<return_stmt>(ref).value));
+            case node_kind::num:
+                return fmt::format("number({})", get<num_expr>(ref).value);
+            case node_kind::array:
+                return fmt::format("array(<{}>)", debug(get<array_expr>(ref).elements));
+            case node_kind::ldouble:
+                return fmt::format("float({})", get<ldouble_expr>(ref).value);
+            case node_kind::string:
+                return fmt::format("string(\"{}\")", str(get<string_expr>(ref).value));
+            case node_kind::break_:
+                return "break";
+            case node_kind::continue_:
+                return "continue";
+            case node_kind::self:
+                return "self";
+            case node_kind::variable: {
+                const auto& n = get<variable_expr>(ref);
+                return fmt::format("variable(name={}, value={})", str(n.name), debug(n.value));
+            }
+            case node_kind::ident:
+                return fmt::format("identifier({})", str(get<ident_expr>(ref).name));
+            case node_kind::if_: {
+                const auto& n = get<if_stmt>(ref);
+                return fmt::format("if(confition={}, then={}, else={})", debug(n.condition), debug(n.then_branch),
+                                   debug(n.else_branch));
+            }
+            case node_kind::call: {
+                const auto& n = get<call_expr>(ref);
+                return fmt::format("call(callee={}, arguments={})", debug(n.callee), debug(n.arguments));
+            }
+            case node_kind::argument: {
+                const auto& n = get<argument_expr>(ref);
+                return fmt::format("argument(name={}, default={})", str(n.name), debug(n.def));
+            }
+            case node_kind::function: {
+                const auto& n = get<function_stmt>(ref);
+                return fmt::format("fnc(name={}, arguments={}, body={})", str(n.name), debug(n.arguments),
+                                   debug(n.body));
+            }
+            case node_kind::for_: {
+                const auto& n = get<for_stmt>(ref);
+                return fmt::format("for(init={}, condition={}, branch={}, body={})", debug(n.init),
+                                   debug(n.condition), debug(n.branch), debug(n.body));
+            }
+            case node_kind::while_: {
+                const auto& n = get<while_stmt>(ref);
+                return fmt::format("while(condition={}, body={})", debug(n.branch), debug(n.body));
+            }
+            case node_kind::class_:
+                return fmt::format("class({})", str(get<class_expr>(ref).name));
+            case node_kind::access: {
+                const auto& n = get<access_expr>(ref);
+                return fmt::format("access(target={}, sub={})", debug(n.target), debug(n.object));
+            }
+            case node_kind::block:
+                return fmt::format("block({})", debug(get<block_stmt>(ref).stmts));
+            case node_kind::subscript: {
+                const auto& n = get<subscript_expr>(ref);
+                return fmt::format("subscript(object={}, target={})", debug(n.object), debug(n.target));
+            }
+            case node_kind::interpolation:
+                return fmt::format("interpolation({})", debug(get<interpolation_expr>(ref).parts));
+            case node_kind::slice: {
+                const auto& n = get<slice_expr>(ref);
+                return fmt::format("slice(object={}, begin={}, end={})", debug(n.object), debug(n.begin),
+                                   debug(n.end));
+            }
+            case node_kind::dict:
+                return fmt::format("dict(<{}>)", debug(get<dict_expr>(ref).entries));
+            case node_kind::lambda:
+                return fmt::format("lambda({})", debug(get<lambda_expr>(ref).function));
+            case node_kind::range: {
+                const auto& n = get<range_expr>(ref);
+                return fmt::format("range(begin={}, end={}, step={})", debug(n.begin), debug(n.end), debug(n.step));
+            }
+            case node_kind::iterate: {
+                const auto& n = get<iterate_stmt>(ref);
+                return fmt::format("iterate(name={}, iterable={}, body={})", str(n.name), debug(n.iterable),
+                                   debug(n.body));
+            }
+        }
+        return "?";
     }
-};
-struct iterate_expr : expr {
-    std::shared_ptr<expr> ident_;
-    std::shared_ptr<expr> target;
-    std::string debug() const override {
-        return fmt::format("iterate(ident={}, target={})", ident_->debug(), target->debug());
+    std::string debug(list_ref l) const {
+        std::string out;
+        for (auto ref : nodes(l)) {
+            if (!out.empty()) out.push_back(',');
+            out += debug(ref);
+        }
+        return out.empty() ? "null" : out;
     }
-};
-struct subscript_expr : expr {
-    std::shared_ptr<expr> object;
-    std::shared_ptr<expr> target;
 
-    subscript_expr(const std::shared_ptr<expr>& o, const std::shared_ptr<expr>& t) : object{o}, target{t} {}
+    // top level statements of the program
+    list_ref program;
 
-    std::string debug() const override {
-        return fmt::format("subscript(object={}, target={})", object->debug(), target->debug());
-    }
+   private:
+    std::vector<std::uint64_t> m_words;
+    std::vector<node_ref> m_lists;
+    std::vector<capture> m_captures;
+    std::deque<std::string> m_strings;
+    std::unordered_map<std::string_view, str_ref> m_string_index;
 };
 }  // namespace skai
 #endif
@@ -0,0 +1,196 @@
+#ifndef SKAI_BYTECODE_HPP_830183UEIEOE
+#define SKAI_BYTECODE_HPP_830183UEIEOE
+#include <fmt/format.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "error.hpp"
+#include "object.hpp"
+#include "scope.hpp"
+
+namespace skai {
+namespace bytecode {
+// operands are encoded inline after the opcode, 'u8' and 'u16' are the operand widths (u16 is little endian)
+enum class opcode : std::uint8_t {
+    constant,       // u16 constant index
+    null,
+    true_,
+    false_,
+    pop,
+    get_local,      // u8 slot
+    set_local,      // u8 slot
+    get_global,     // u16 global index
+    set_global,     // u16 global index
+    define_global,  // u16 global index, u8 is_const
+    get_upvalue,    // u8 upvalue index
+    set_upvalue,    // u8 upvalue index
+    // compound assignments update the variable in place: the rhs is on the stack and is replaced by the result
+    compound_local,   // u8 slot, u8 operator token
+    compound_global,  // u16 global index, u8 operator token
+    compound_upvalue, // u8 upvalue index, u8 operator token
+    close_upvalue,
+    // binary operators are followed by a u8 countdown to quickening, see 'quickenings'
+    add,
+    sub,
+    mul,
+    div,
+    mod,
+    b_and,
+    b_or,
+    xor_,
+    lshift,
+    rshift,
+    eq,
+    not_eq_,
+    lt,
+    lt_eq,
+    gt,
+    gt_eq,
+    not_,
+    negate,
+    plus,
+    to_bool,
+    jump,           // u16 forward offset
+    jump_if_false,  // u16 forward offset, pops the condition
+    jump_if_bound,  // u8 slot, u16 forward offset, skips a default argument initializer
+    loop,           // u16 backward offset
+    call,           // u8 argument count
+    closure,        // u16 constant index, then (u8 is_local, u8 index) for every upvalue
+    return_,
+    array,          // u16 element count
+    dict,           // u16 entry count, the keys and values alternate on the stack
+    interpolate,    // u16 part count, the parts are replaced by the string
+    subscript,
+    set_subscript,  // pops the value and the index, leaves the value in place of the target
+    slice,          // pops the end and the begin (null if omitted)
+    invoke,         // u16 constant index of the method name, u8 argument count
+    range,          // pops the step (null if omitted), the end and the begin
+    iterate,        // u8 slot of the iterable, u16 forward offset taken once it's exhausted
+    // quickened forms, written over a binary operator by the vm. they check the operand types and put the generic
+    // opcode back when the check fails
+    add_ii,
+    sub_ii,
+    mul_ii,
+    mod_ii,
+    eq_ii,
+    not_eq_ii,
+    lt_ii,
+    lt_eq_ii,
+    gt_ii,
+    gt_eq_ii,
+    add_ff,
+    sub_ff,
+    mul_ff,
+    div_ff,
+    lt_ff,
+    lt_eq_ff,
+    gt_ff,
+    gt_eq_ff,
+    add_ss,
+    eq_ss,
+};
+
+// a binary operator site runs 'quicken_warmup' times before it's quickened for the operand types it sees, the same
+// site waits 'quicken_backoff' executions after a failed attempt or a failed check before it tries again
+constexpr std::uint8_t quicken_warmup = 8;
+constexpr std::uint8_t quicken_backoff = 255;
+
+struct quickening {
+    opcode generic;
+    object::type_id type;
+    opcode quick;
+};
+inline constexpr quickening quickenings[] = {
+    {opcode::add, object::type_id::integer, opcode::add_ii},
+    {opcode::sub, object::type_id::integer, opcode::sub_ii},
+    {opcode::mul, object::type_id::integer, opcode::mul_ii},
+    {opcode::mod, object::type_id::integer, opcode::mod_ii},
+    {opcode::eq, object::type_id::integer, opcode::eq_ii},
+    {opcode::not_eq_, object::type_id::integer, opcode::not_eq_ii},
+    {opcode::lt, object::type_id::integer, opcode::lt_ii},
+    {opcode::lt_eq, object::type_id::integer, opcode::lt_eq_ii},
+    {opcode::gt, object::type_id::integer, opcode::gt_ii},
+    {opcode::gt_eq, object::type_id::integer, opcode::gt_eq_ii},
+    {opcode::add, object::type_id::floating, opcode::add_ff},
+    {opcode::sub, object::type_id::floating, opcode::sub_ff},
+    {opcode::mul, object::type_id::floating, opcode::mul_ff},
+    {opcode::div, object::type_id::floating, opcode::div_ff},
+    {opcode::lt, object::type_id::floating, opcode::lt_ff},
+    {opcode::lt_eq, object::type_id::floating, opcode::lt_eq_ff},
+    {opcode::gt, object::type_id::floating, opcode::gt_ff},
+    {opcode::gt_eq, object::type_id::floating, opcode::gt_eq_ff},
+    {opcode::add, object::type_id::string, opcode::add_ss},
+    {opcode::eq, object::type_id::string, opcode::eq_ss},
+};
+// quickened form of 'op' for two operands of type 'id', 'op' itself if there is none
+inline opcode quickened(opcode op, object::type_id id) {
+    for (const auto& q : quickenings)
+        if (q.generic == op && q.type == id) return q.quick;
+    return op;
+}
+// the binary operator a quickened opcode was written over
+inline opcode generic(opcode quick) {
+    for (const auto& q : quickenings)
+        if (q.quick == quick) return q.generic;
+    return quick;
+}
+
+struct chunk {
+    std::vector<std::uint8_t> code;
+    std::vector<object::value> constants;
+
+    void emit(opcode op) {
+        code.push_back(static_cast<std::uint8_t>(op));
+    }
+    void emit_u8(std::uint8_t b) {
+        code.push_back(b);
+    }
+    // binary operators carry their quickening countdown
+    void emit_binary(opcode op) {
+        emit(op);
+        emit_u8(quicken_warmup);
+    }
+    void emit_u16(std::uint16_t v) {
+        code.push_back(static_cast<std::uint8_t>(v & 0xff));
+        code.push_back(static_cast<std::uint8_t>(v >> 8));
+    }
+    void patch_u16(std::size_t at, std::uint16_t v) {
+        code.at(at) = static_cast<std::uint8_t>(v & 0xff);
+        code.at(at + 1) = static_cast<std::uint8_t>(v >> 8);
+    }
+    std::uint16_t add_constant(const object::value& obj) {
+        if (constants.size() >= UINT16_MAX) throw skai::exception{"too many constants in one function"};
+        constants.push_back(obj);
+        return static_cast<std::uint16_t>(constants.size() - 1);
+    }
+};
+
+// compiled function body, lives in the constant table of the enclosing function and gets wrapped into a closure at
+// runtime
+struct proto : object::object {
+    std::string name;
+    std::size_t arity{};
+    std::size_t min_arity{};
+    std::size_t upvalues{};
+    // slots a call needs at most, from the callee slot to the deepest operand. the vm checks it up front so that
+    // nothing in the body has to check for room before pushing
+    std::size_t max_stack{};
+    chunk code;
+
+    proto(const std::string& n) : name{n} {}
+
+    std::string to_string() const override {
+        return fmt::format("[function '{}']", name);
+    }
+    std::string type_to_string() const override {
+        return "function";
+    }
+};
+
+using global_table = skai::global_table<object::value>;
+}  // namespace bytecode
+}  // namespace skai
+#endif
@@ -0,0 +1,667 @@
+#ifndef SKAI_COMPILER_HPP_392011EIEOPE
+#define SKAI_COMPILER_HPP_392011EIEOPE
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ast.hpp"
+#include "bytecode.hpp"
+#include "error.hpp"
+#include "object.hpp"
+
+namespace skai {
+// lowers the ast produced by the parser into bytecode for the vm, locals are resolved to stack slots and globals to
+// indices into the shared global table
+struct compiler {
+    compiler(bytecode::global_table& globals) : m_globals{globals} {}
+
+    object::ref<bytecode::proto> compile(const ast& tree) {
+        m_ast = &tree;
+        auto script = object::make<bytecode::proto>("script");
+        function_state state{script.get(), nullptr};
+        state.locals.push_back(local{{}, 0, false, false});
+        m_state = &state;
+        m_stack(1);
+        for (auto stmt : tree.nodes(tree.program)) m_stmt(stmt);
+        m_emit(bytecode::opcode::null);
+        m_emit(bytecode::opcode::return_);
+        m_state = nullptr;
+        return script;
+    }
+
+   private:
+    using opcode = bytecode::opcode;
+
+    // name of the locals the compiler adds for itself, no identifier resolves to it
+    static constexpr str_ref unnamed = UINT32_MAX;
+
+    // names are the interned handles of the ast, scopes compare them as integers
+    struct local {
+        str_ref name;
+        int depth;
+        bool is_const;
+        bool captured;
+    };
+    struct upvalue {
+        std::uint8_t index;
+        bool is_local;
+        bool is_const;
+    };
+    struct loop {
+        int depth;
+        std::vector<std::size_t> breaks;
+        std::vector<std::size_t> continues;
+    };
+    struct function_state {
+        bytecode::proto* fn;
+        function_state* enclosing;
+        std::vector<local> locals{};
+        std::vector<upvalue> upvalues{};
+        std::vector<loop> loops{};
+        int depth = 0;
+        // values on the stack of the frame at the current point of the code, locals included
+        std::ptrdiff_t stack = 0;
+    };
+
+    bytecode::chunk& m_chunk() {
+        return m_state->fn->code;
+    }
+    void m_emit(opcode op) {
+        m_chunk().emit(op);
+        m_stack(m_stack_effect(op, 0));
+    }
+    void m_emit(opcode op, std::uint8_t operand) {
+        m_chunk().emit(op);
+        m_chunk().emit_u8(operand);
+        m_stack(m_stack_effect(op, operand));
+    }
+    void m_emit_u16(opcode op, std::uint16_t operand) {
+        m_chunk().emit(op);
+        m_chunk().emit_u16(operand);
+        m_stack(m_stack_effect(op, operand));
+    }
+    void m_emit_binary(opcode op) {
+        m_chunk().emit_binary(op);
+        m_stack(-1);
+    }
+    void m_emit_constant(const object::value& obj) {
+        m_emit_u16(opcode::constant, m_chunk().add_constant(obj));
+    }
+    // emits a forward jump with a placeholder offset, returns the position of the offset
+    std::size_t m_emit_jump(opcode op) {
+        m_emit_u16(op, 0xffff);
+        return m_chunk().code.size() - 2;
+    }
+    void m_patch_jump(std::size_t at) {
+        auto offset = m_chunk().code.size() - at - 2;
+        if (offset > UINT16_MAX) throw skai::exception{"too much code to jump over"};
+        m_chunk().patch_u16(at, static_cast<std::uint16_t>(offset));
+    }
+    void m_emit_loop(std::size_t start) {
+        auto offset = m_chunk().code.size() - start + 3;
+        if (offset > UINT16_MAX) throw skai::exception{"loop body too large"};
+        m_emit_u16(opcode::loop, static_cast<std::uint16_t>(offset));
+    }
+
+    // the code is compiled in order and every statement leaves the stack as it found it, so following the pushes and
+    // pops along the code gives the depth of every point. the few places that jump over code adjust it by hand
+    void m_stack(std::ptrdiff_t delta) {
+        m_state->stack += delta;
+        m_state->fn->max_stack = std::max(m_state->fn->max_stack, static_cast<std::size_t>(m_state->stack));
+    }
+    // net number of values 'op' pushes, 'operand' is its first operand. 'invoke' is accounted for by its caller, its
+    // argument count is its second operand
+    static std::ptrdiff_t m_stack_effect(opcode op, std::uint16_t operand) {
+        switch (op) {
+            case opcode::constant:
+            case opcode::null:
+            case opcode::true_:
+            case opcode::false_:
+            case opcode::get_local:
+            case opcode::get_global:
+            case opcode::get_upvalue:
+            case opcode::closure:
+                return 1;
+            case opcode::pop:
+            case opcode::define_global:
+            case opcode::close_upvalue:
+            case opcode::jump_if_false:
+            case opcode::return_:
+            case opcode::subscript:
+                return -1;
+            case opcode::set_subscript:
+            case opcode::slice:
+            case opcode::range:
+                return -2;
+            case opcode::call:
+                return -static_cast<std::ptrdiff_t>(operand);
+            case opcode::array:
+            case opcode::interpolate:
+                return 1 - static_cast<std::ptrdiff_t>(operand);
+            case opcode::dict:
+                return 1 - 2 * static_cast<std::ptrdiff_t>(operand);
+            default:
+                return 0;
+        }
+    }
+
+    void m_begin_scope() {
+        ++m_state->depth;
+    }
+    void m_end_scope() {
+        --m_state->depth;
+        auto& locals = m_state->locals;
+        while (!locals.empty() && locals.back().depth > m_state->depth) {
+            m_emit(locals.back().captured ? opcode::close_upvalue : opcode::pop);
+            locals.pop_back();
+        }
+    }
+    // pops the locals that live deeper than 'depth' without forgetting them, used by break/continue
+    void m_discard_locals(int depth) {
+        const auto& locals = m_state->locals;
+        for (auto it = locals.rbegin(); it != locals.rend() && it->depth > depth; ++it)
+            m_emit(it->captured ? opcode::close_upvalue : opcode::pop);
+    }
+    std::uint8_t m_add_local(str_ref name, bool is_const) {
+        if (m_state->locals.size() > UINT8_MAX) throw skai::exception{"too many local variables in function"};
+        m_state->locals.push_back(local{name, m_state->depth, is_const, false});
+        return static_cast<std::uint8_t>(m_state->locals.size() - 1);
+    }
+
+    static int m_resolve_local(function_state* state, str_ref name) {
+        for (auto i = static_cast<int>(state->locals.size()) - 1; i > 0; --i)
+            if (state->locals[i].name == name) return i;
+        return -1;
+    }
+    static int m_add_upvalue(function_state* state, std::uint8_t index, bool is_local, bool is_const) {
+        for (std::size_t i = 0; i < state->upvalues.size(); ++i)
+            if (state->upvalues[i].index == index && state->upvalues[i].is_local == is_local) return static_cast<int>(i);
+        if (state->upvalues.size() > UINT8_MAX) throw skai::exception{"too many captured variables in function"};
+        state->upvalues.push_back(upvalue{index, is_local, is_const});
+        state->fn->upvalues = state->upvalues.size();
+        return static_cast<int>(state->upvalues.size() - 1);
+    }
+    static int m_resolve_upvalue(function_state* state, str_ref name) {
+        if (state->enclosing == nullptr) return -1;
+        if (auto loc = m_resolve_local(state->enclosing, name); loc != -1) {
+            auto& captured = state->enclosing->locals[loc];
+            captured.captured = true;
+            return m_add_upvalue(state, static_cast<std::uint8_t>(loc), true, captured.is_const);
+        }
+        if (auto up = m_resolve_upvalue(state->enclosing, name); up != -1)
+            return m_add_upvalue(state, static_cast<std::uint8_t>(up), false, state->enclosing->upvalues[up].is_const);
+        return -1;
+    }
+
+    void m_get_variable(str_ref name) {
+        if (auto slot = m_resolve_local(m_state, name); slot != -1) {
+            m_emit(opcode::get_local, static_cast<std::uint8_t>(slot));
+        } else if (auto up = m_resolve_upvalue(m_state, name); up != -1) {
+            m_emit(opcode::get_upvalue, static_cast<std::uint8_t>(up));
+        } else {
+            m_emit_u16(opcode::get_global, m_globals.index_of(m_ast->str(name)));
+        }
+    }
+    void m_set_variable(str_ref name) {
+        if (auto slot = m_resolve_local(m_state, name); slot != -1) {
+            if (m_state->locals[slot].is_const)
+                throw skai::exception{fmt::format("assigning to const variable '{}'", m_ast->str(name))};
+            m_emit(opcode::set_local, static_cast<std::uint8_t>(slot));
+        } else if (auto up = m_resolve_upvalue(m_state, name); up != -1) {
+            if (m_state->upvalues[up].is_const)
+                throw skai::exception{fmt::format("assigning to const variable '{}'", m_ast->str(name))};
+            m_emit(opcode::set_upvalue, static_cast<std::uint8_t>(up));
+        } else {
+            m_emit_u16(opcode::set_global, m_globals.index_of(m_ast->str(name)));
+        }
+    }
+
+    void m_stmt(node_ref ref) {
+        const auto& tree = *m_ast;
+        switch (tree.kind(ref)) {
+            case node_kind::null:
+                return;
+            case node_kind::variable:
+                return m_visit_var(tree.get<variable_expr>(ref));
+            case node_kind::function:
+                return m_visit_func(tree.get<function_stmt>(ref));
+            case node_kind::if_:
+                return m_visit_if_stmt(tree.get<if_stmt>(ref));
+            case node_kind::while_:
+                return m_visit_while(tree.get<while_stmt>(ref));
+            case node_kind::for_:
+                return m_visit_for(tree.get<for_stmt>(ref));
+            case node_kind::iterate:
+                return m_visit_iterate(tree.get<iterate_stmt>(ref));
+            case node_kind::block:
+                return m_visit_block(tree.get<block_stmt>(ref));
+            case node_kind::return_:
+                return m_visit_return(tree.get<return_stmt>(ref));
+            case node_kind::break_:
+                return m_visit_jump(true);
+            case node_kind::continue_:
+                return m_visit_jump(false);
+            default:
+                m_expr(ref);
+                m_emit(opcode::pop);
+        }
+    }
+
+    void m_expr(node_ref ref) {
+        const auto& tree = *m_ast;
+        switch (tree.kind(ref)) {
+            case node_kind::null:
+                return m_emit(opcode::null);
+            case node_kind::call:
+                return m_visit_call(tree.get<call_expr>(ref));
+            case node_kind::binary:
+                return m_visit_binary_expr(tree.get<binary_expr>(ref));
+            case node_kind::logical:
+                return m_visit_logical(tree.get<logical_expr>(ref));
+            case node_kind::ident:
+                return m_get_variable(tree.get<ident_expr>(ref).name);
+            case node_kind::num:
+                return m_emit_constant(object::value::integer(tree.get<num_expr>(ref).value));
+            case node_kind::ldouble:
+                return m_emit_constant(object::value::floating(tree.get<ldouble_expr>(ref).value));
+            case node_kind::string:
+                return m_emit_constant(object::intern(tree.str(tree.get<string_expr>(ref).value)));
+            case node_kind::bool_:
+                return m_emit(tree.get<bool_expr>(ref).value ? opcode::true_ : opcode::false_);
+            case node_kind::assign:
+                return m_visit_assign(tree.get<assign_expr>(ref));
+            case node_kind::unary:
+                return m_visit_unary(tree.get<unary_expr>(ref));
+            case node_kind::array:
+                return m_visit_arr(tree.get<array_expr>(ref));
+            case node_kind::dict:
+                return m_visit_dict(tree.get<dict_expr>(ref));
+            case node_kind::interpolation:
+                return m_visit_interpolation(tree.get<interpolation_expr>(ref));
+            case node_kind::subscript:
+                return m_visit_subsc(tree.get<subscript_expr>(ref));
+            case node_kind::slice:
+                return m_visit_slice(tree.get<slice_expr>(ref));
+            case node_kind::range:
+                return m_visit_range(tree.get<range_expr>(ref));
+            case node_kind::lambda:
+                return m_function(tree.get<function_stmt>(tree.get<lambda_expr>(ref).function));
+            case node_kind::access:
+                throw skai::exception{"member access is not supported yet"};
+            default:
+                throw skai::exception{fmt::format("unsupported expression '{}'", tree.debug(ref))};
+        }
+    }
+
+    void m_visit_var(const variable_expr& var) {
+        m_expr(var.value);
+        if (m_state->depth == 0 && m_state->enclosing == nullptr) {
+            m_emit_u16(opcode::define_global, m_globals.index_of(m_ast->str(var.name)));
+            m_chunk().emit_u8(var.is_const);
+        } else {
+            m_add_local(var.name, var.is_const);
+        }
+    }
+
+    void m_visit_func(const function_stmt& ftst) {
+        bool global = m_state->depth == 0 && m_state->enclosing == nullptr;
+        // declared before the body gets compiled so that the function can refer to itself
+        if (!global) m_add_local(ftst.name, false);
+        m_function(ftst);
+        if (global) {
+            m_emit_u16(opcode::define_global, m_globals.index_of(m_ast->str(ftst.name)));
+            m_chunk().emit_u8(false);
+        }
+    }
+    // compiles the body and leaves the closure on the stack
+    void m_function(const function_stmt& ftst) {
+        auto args = m_ast->nodes(ftst.arguments);
+        auto fn = object::make<bytecode::proto>(m_ast->str(ftst.name));
+        fn->arity = args.size();
+        fn->min_arity = std::count_if(args.begin(), args.end(),
+                                      [this](node_ref arg) { return m_ast->get<argument_expr>(arg).def == 0; });
+        function_state state{fn.get(), m_state};
+        state.depth = 1;
+        state.locals.push_back(local{{}, 1, false, false});
+        m_state = &state;
+        m_stack(static_cast<std::ptrdiff_t>(args.size()) + 1);
+        for (auto arg : args) m_add_local(m_ast->get<argument_expr>(arg).name, false);
+        for (std::size_t i = 0; i < args.size(); ++i) {
+            const auto& arg = m_ast->get<argument_expr>(args[i]);
+            if (arg.def == 0) continue;
+            m_emit(opcode::jump_if_bound, static_cast<std::uint8_t>(i + 1));
+            m_chunk().emit_u16(0xffff);
+            auto skip = m_chunk().code.size() - 2;
+            m_expr(arg.def);
+            m_emit(opcode::set_local, static_cast<std::uint8_t>(i + 1));
+            m_emit(opcode::pop);
+            m_patch_jump(skip);
+        }
+        for (auto stmt : m_ast->nodes(ftst.body)) m_stmt(stmt);
+        m_emit(opcode::null);
+        m_emit(opcode::return_);
+        m_state = state.enclosing;
+
+        m_emit_u16(opcode::closure, m_chunk().add_constant(fn));
+        for (const auto& up : state.upvalues) {
+            m_chunk().emit_u8(up.is_local);
+            m_chunk().emit_u8(up.index);
+        }
+    }
+
+    void m_visit_if_stmt(const if_stmt& stmt) {
+        m_begin_scope();
+        m_stmt(stmt.init);
+        m_expr(stmt.condition);
+        auto then_jump = m_emit_jump(opcode::jump_if_false);
+        m_stmt(stmt.then_branch);
+        if (stmt.else_branch != 0) {
+            auto else_jump = m_emit_jump(opcode::jump);
+            m_patch_jump(then_jump);
+            m_stmt(stmt.else_branch);
+            m_patch_jump(else_jump);
+        } else {
+            m_patch_jump(then_jump);
+        }
+        m_end_scope();
+    }
+
+    void m_visit_while(const while_stmt& stmt) {
+        m_begin_scope();
+        m_stmt(stmt.init);
+        auto start = m_chunk().code.size();
+        m_expr(stmt.branch);
+        auto exit = m_emit_jump(opcode::jump_if_false);
+        m_loop_body(stmt.body);
+        for (auto at : m_state->loops.back().continues) m_patch_jump(at);
+        m_emit_loop(start);
+        m_patch_jump(exit);
+        m_end_loop();
+        m_end_scope();
+    }
+
+    void m_visit_for(const for_stmt& stmt) {
+        m_begin_scope();
+        m_stmt(stmt.init);
+        auto start = m_chunk().code.size();
+        m_expr(stmt.condition);
+        auto exit = m_emit_jump(opcode::jump_if_false);
+        m_loop_body(stmt.body);
+        for (auto at : m_state->loops.back().continues) m_patch_jump(at);
+        m_expr(stmt.branch);
+        m_emit(opcode::pop);
+        m_emit_loop(start);
+        m_patch_jump(exit);
+        m_end_loop();
+        m_end_scope();
+    }
+
+    // the iterable, its cursor and the variable take three consecutive slots, 'iterate' overwrites the variable with
+    // the next element or leaves the loop
+    void m_visit_iterate(const iterate_stmt& stmt) {
+        m_begin_scope();
+        m_expr(stmt.iterable);
+        auto slot = m_add_local(unnamed, false);
+        m_emit_constant(object::value::integer(0));
+        m_add_local(unnamed, false);
+        m_emit(opcode::null);
+        m_add_local(stmt.name, false);
+        auto start = m_chunk().code.size();
+        m_emit(opcode::iterate, slot);
+        m_chunk().emit_u16(0xffff);
+        auto exit = m_chunk().code.size() - 2;
+        m_loop_body(stmt.body);
+        for (auto at : m_state->loops.back().continues) m_patch_jump(at);
+        m_emit_loop(start);
+        m_patch_jump(exit);
+        m_end_loop();
+        m_end_scope();
+    }
+
+    void m_loop_body(node_ref body) {
+        m_state->loops.push_back(loop{m_state->depth, {}, {}});
+        m_begin_scope();
+        m_stmt(body);
+        m_end_scope();
+    }
+    void m_end_loop() {
+        for (auto at : m_state->loops.back().breaks) m_patch_jump(at);
+        m_state->loops.pop_back();
+    }
+
+    void m_visit_jump(bool is_break) {
+        if (m_state->loops.empty())
+            throw skai::exception{fmt::format("'{}' outside of a loop", is_break ? "break" : "continue")};
+        auto& current = m_state->loops.back();
+        // the locals are popped again where the code goes on after the jump
+        auto stack = m_state->stack;
+        m_discard_locals(current.depth);
+        m_state->stack = stack;
+        (is_break ? current.breaks : current.continues).push_back(m_emit_jump(opcode::jump));
+    }
+
+    void m_visit_block(const block_stmt& block) {
+        m_begin_scope();
+        for (auto stmt : m_ast->nodes(block.stmts)) m_stmt(stmt);
+        m_end_scope();
+    }
+
+    void m_visit_return(const return_stmt& rtst) {
+        if (m_state->enclosing == nullptr)
+            throw skai::exception{"return statements are only valid in functions definitions"};
+        m_expr(rtst.value);
+        m_emit(opcode::return_);
+    }
+
+    void m_visit_call(const call_expr& cexpr) {
+        if (cexpr.arguments.size > UINT8_MAX) throw skai::exception{"can't have more than 255 arguments"};
+        if (m_ast->kind(cexpr.callee) == node_kind::access) {
+            const auto& access = m_ast->get<access_expr>(cexpr.callee);
+            m_expr(access.target);
+            for (auto arg : m_ast->nodes(cexpr.arguments)) m_expr(arg);
+            const auto& name = m_ast->str(m_ast->get<ident_expr>(access.object).name);
+            m_emit_u16(opcode::invoke, m_chunk().add_constant(object::intern(name)));
+            m_chunk().emit_u8(static_cast<std::uint8_t>(cexpr.arguments.size));
+            m_stack(-static_cast<std::ptrdiff_t>(cexpr.arguments.size));
+            return;
+        }
+        m_expr(cexpr.callee);
+        for (auto arg : m_ast->nodes(cexpr.arguments)) m_expr(arg);
+        m_emit(opcode::call, static_cast<std::uint8_t>(cexpr.arguments.size));
+    }
+
+    void m_visit_assign(const assign_expr& aexpr) {
+        if (m_ast->kind(aexpr.lhs) == node_kind::subscript) {
+            const auto& sexpr = m_ast->get<subscript_expr>(aexpr.lhs);
+            m_expr(sexpr.object);
+            m_expr(sexpr.target);
+            m_expr(aexpr.rhs);
+            m_emit(opcode::set_subscript);
+            return;
+        }
+        if (m_ast->kind(aexpr.lhs) != node_kind::ident) throw skai::exception{"invalid operand for '='"};
+        m_expr(aexpr.rhs);
+        m_set_variable(m_ast->get<ident_expr>(aexpr.lhs).name);
+    }
+
+    void m_visit_unary(const unary_expr& uexpr) {
+        m_expr(uexpr.operand);
+        switch (uexpr.op) {
+            case token::minus:
+                return m_emit(opcode::negate);
+            case token::plus:
+                return m_emit(opcode::plus);
+            case token::not_:
+                return m_emit(opcode::not_);
+        }
+        throw skai::exception{"invalid unary operator"};
+    }
+
+    void m_visit_arr(const array_expr& aexpr) {
+        if (aexpr.elements.size > UINT16_MAX) throw skai::exception{"array literal too large"};
+        for (auto elm : m_ast->nodes(aexpr.elements)) m_expr(elm);
+        m_emit_u16(opcode::array, static_cast<std::uint16_t>(aexpr.elements.size));
+    }
+
+    void m_visit_range(const range_expr& rexpr) {
+        m_expr(rexpr.begin);
+        m_expr(rexpr.end);
+        m_expr(rexpr.step);
+        m_emit(opcode::range);
+    }
+
+    void m_visit_dict(const dict_expr& dexpr) {
+        if (dexpr.entries.size / 2 > UINT16_MAX) throw skai::exception{"dict literal too large"};
+        for (auto elm : m_ast->nodes(dexpr.entries)) m_expr(elm);
+        m_emit_u16(opcode::dict, static_cast<std::uint16_t>(dexpr.entries.size / 2));
+    }
+
+    void m_visit_interpolation(const interpolation_expr& interp) {
+        if (interp.parts.size > UINT16_MAX) throw skai::exception{"too many parts in interpolated string"};
+        for (auto part : m_ast->nodes(interp.parts)) m_expr(part);
+        m_emit_u16(opcode::interpolate, static_cast<std::uint16_t>(interp.parts.size));
+    }
+
+    void m_visit_slice(const slice_expr& sexpr) {
+        m_expr(sexpr.object);
+        if (sexpr.begin != 0)
+            m_expr(sexpr.begin);
+        else
+            m_emit(opcode::null);
+        if (sexpr.end != 0)
+            m_expr(sexpr.end);
+        else
+            m_emit(opcode::null);
+        m_emit(opcode::slice);
+    }
+
+    void m_visit_subsc(const subscript_expr& sexpr) {
+        m_expr(sexpr.object);
+        m_expr(sexpr.target);
+        m_emit(opcode::subscript);
+    }
+
+    void m_visit_logical(const logical_expr& expr_) {
+        m_expr(expr_.lhs);
+        auto short_circuit = m_emit_jump(opcode::jump_if_false);
+        if (expr_.op == token::and_) {
+            m_expr(expr_.rhs);
+            m_emit(opcode::to_bool);
+            auto end = m_emit_jump(opcode::jump);
+            // the short circuit path starts without the result of the other one
+            m_stack(-1);
+            m_patch_jump(short_circuit);
+            m_emit(opcode::false_);
+            m_patch_jump(end);
+        } else {
+            m_emit(opcode::true_);
+            auto end = m_emit_jump(opcode::jump);
+            m_stack(-1);
+            m_patch_jump(short_circuit);
+            m_expr(expr_.rhs);
+            m_emit(opcode::to_bool);
+            m_patch_jump(end);
+        }
+    }
+
+    void m_visit_binary_expr(const binary_expr& bin) {
+        if (auto op = m_compound_op(bin.op); op != opcode::pop) {
+            if (m_ast->kind(bin.lhs) != node_kind::ident)
+                throw skai::exception{"invalid operand for compound assignment"};
+            auto name = m_ast->get<ident_expr>(bin.lhs).name;
+            auto base = static_cast<std::uint8_t>(compound_base(bin.op));
+            // the in place forms read the variable once the rhs has been evaluated, like the walker does
+            if (auto slot = m_resolve_local(m_state, name); slot != -1) {
+                if (m_state->locals[slot].is_const)
+                    throw skai::exception{fmt::format("assigning to const variable '{}'", m_ast->str(name))};
+                m_expr(bin.rhs);
+                m_emit(opcode::compound_local, static_cast<std::uint8_t>(slot));
+                m_chunk().emit_u8(base);
+            } else if (auto up = m_resolve_upvalue(m_state, name); up != -1) {
+                if (m_state->upvalues[up].is_const)
+                    throw skai::exception{fmt::format("assigning to const variable '{}'", m_ast->str(name))};
+                m_expr(bin.rhs);
+                m_emit(opcode::compound_upvalue, static_cast<std::uint8_t>(up));
+                m_chunk().emit_u8(base);
+            } else {
+                m_expr(bin.rhs);
+                m_emit_u16(opcode::compound_global, m_globals.index_of(m_ast->str(name)));
+                m_chunk().emit_u8(base);
+            }
+            return;
+        }
+        m_expr(bin.lhs);
+        m_expr(bin.rhs);
+        switch (bin.op) {
+            case token::plus:
+                return m_emit_binary(opcode::add);
+            case token::minus:
+                return m_emit_binary(opcode::sub);
+            case token::star:
+                return m_emit_binary(opcode::mul);
+            case token::slash:
+                return m_emit_binary(opcode::div);
+            case token::mod:
+                return m_emit_binary(opcode::mod);
+            case token::b_and:
+                return m_emit_binary(opcode::b_and);
+            case token::b_or:
+                return m_emit_binary(opcode::b_or);
+            case token::xor_:
+                return m_emit_binary(opcode::xor_);
+            case token::lshift:
+                return m_emit_binary(opcode::lshift);
+            case token::rshift:
+                return m_emit_binary(opcode::rshift);
+            case token::d_eq:
+                return m_emit_binary(opcode::eq);
+            case token::not_eq_:
+                return m_emit_binary(opcode::not_eq_);
+            case token::lt:
+                return m_emit_binary(opcode::lt);
+            case token::lt_eq:
+                return m_emit_binary(opcode::lt_eq);
+            case token::gt:
+                return m_emit_binary(opcode::gt);
+            case token::gt_eq:
+                return m_emit_binary(opcode::gt_eq);
+        }
+        throw skai::exception{"invalid binary operator"};
+    }
+
+    // maps a compound assignment token to the arithmetic it performs, 'pop' means it's not a compound assignment
+    static opcode m_compound_op(token tok) {
+        switch (tok) {
+            case token::plus_eq:
+                return opcode::add;
+            case token::minus_eq:
+                return opcode::sub;
+            case token::star_eq:
+                return opcode::mul;
+            case token::slash_eq:
+                return opcode::div;
+            case token::mod_eq:
+                return opcode::mod;
+            case token::b_and_eq:
+                return opcode::b_and;
+            case token::b_or_eq:
+                return opcode::b_or;
+            case token::xor_eq_:
+                return opcode::xor_;
+            case token::lshift_eq:
+                return opcode::lshift;
+            case token::rshift_eq:
+                return opcode::rshift;
+        }
+        return opcode::pop;
+    }
+
+    bytecode::global_table& m_globals;
+    function_state* m_state{};
+    const ast* m_ast{};
+};
+}  // namespace skai
+#endif
@@ -2,8 +2,7 @@
 #define SKAI_INTERPRETER_HPP_UEOEPEPE738393
 #include <algorithm>
 #include <string>
-#include <map>
-#include <memory>
+#include <cstdint>
 #include <skai/libs/builtins.hpp>
 #include <skai/utils.hpp>
 #include <utility>
@@ -16,297 +15,458 @@
 #include "scope.hpp"
 
 namespace skai {
-struct interpreter {
-    interpreter() : m_globals{}, m_ret{std::make_shared<object::null>()} {
-        m_globals.define("print", std::make_shared<builtins::print<interpreter>>());
-        m_globals.define("prompt", std::make_shared<builtins::prompt<interpreter>>());
-        m_globals.define("random", std::make_shared<builtins::random<interpreter>>());
-        m_globals.define("time", std::make_shared<builtins::time<interpreter>>());
-        m_globals.define("sleep", std::make_shared<builtins::sleep<interpreter>>());
-        m_globals.define("type_of", std::make_shared<builtins::type_of<interpreter>>());
-        m_env = m_globals;
+struct interpreter : object::invoker {
+    static constexpr std::size_t max_frames = 1024;
+    static constexpr std::size_t max_stack = max_frames * 64;
+    using upvalues = std::vector<object::ref<object::cell>>;
+
+    interpreter() : m_globals{}, m_ret{}, m_stack(max_stack) {
+        m_globals.define("print", object::make<builtins::print<interpreter>>());
+        m_globals.define("prompt", object::make<builtins::prompt<interpreter>>());
+        m_globals.define("random", object::make<builtins::random<interpreter>>());
+        m_globals.define("time", object::make<builtins::time<interpreter>>());
+        m_globals.define("sleep", object::make<builtins::sleep<interpreter>>());
+        m_globals.define("type_of", object::make<builtins::type_of<interpreter>>());
+        m_globals.define("len", object::make<builtins::len<interpreter>>());
+        m_globals.define("contains", object::make<builtins::contains<interpreter>>());
+        m_globals.define("remove", object::make<builtins::remove<interpreter>>());
+        m_globals.define("gc", object::make<builtins::gc<interpreter>>());
     }
 
-    void interpret(const std::vector<std::shared_ptr<expr>>& exprs) {
-        for (auto& elm : exprs) m_eval(elm);
+    global_table<object::value>& globals() {
+        return m_globals;
     }
 
-    std::shared_ptr<object::object> m_eval(std::shared_ptr<expr> expr_) {
-        auto expr_o = expr_.get();
-        if (expr_o == nullptr) return std::make_shared<object::null>();
-
-        if (auto fexpr = dynamic_cast<call_expr*>(expr_o))
-            return m_visit_call(fexpr);
-
-        else if (auto fexpr = dynamic_cast<binary_expr*>(expr_o))
-            return m_visit_binary_expr(fexpr);
-
-        else if (auto fexpr = dynamic_cast<access_expr*>(expr_o))
-            return m_visit_access(fexpr);
-
-        else if (auto fexpr = dynamic_cast<logical_expr*>(expr_o))
-            return m_visit_logical(fexpr);
-
-        else if (auto fexpr = dynamic_cast<string_expr*>(expr_o))
-            return std::make_shared<object::string>(fexpr->value);
-
-        else if (auto fexpr = dynamic_cast<num_expr*>(expr_o))
-            return std::make_shared<object::integer>(fexpr->value);
-
-        else if (auto fexpr = dynamic_cast<ldouble_expr*>(expr_o))
-            return std::make_shared<object::ldouble>(fexpr->value);
-
-        else if (auto fexpr = dynamic_cast<bool_expr*>(expr_o))
-            return std::make_shared<object::boolean>(fexpr->value);
-
-        else if (dynamic_cast<null_expr*>(expr_o))
-            return std::make_shared<object::null>();
-
-        else if (auto fexpr = dynamic_cast<variable_expr*>(expr_o))
-            return m_visit_var(fexpr);
-
-        else if (auto fexpr = dynamic_cast<ident_expr*>(expr_o))
-            return m_visit_ident(fexpr);
-
-        else if (auto fexpr = dynamic_cast<assign_expr*>(expr_o))
-            return m_visit_assign(fexpr);
-
-        else if (auto fexpr = dynamic_cast<function_stmt*>(expr_o))
-            return m_visit_func(fexpr);
-
-        else if (auto fexpr = dynamic_cast<if_stmt*>(expr_o))
-            return m_visit_if_stmt(fexpr);
+    // 'script' is the program as wrapped by the resolver
+    void interpret(const ast& tree, node_ref script_ref) {
+        m_ast = &tree;
+        const auto& script = tree.get<function_stmt>(script_ref);
+        upvalues none;
+        auto saved = m_push_frame(script, none);
+        m_exec_block(script.body);
+        m_pop_frame(saved);
+    }
 
-        else if (auto fexpr = dynamic_cast<return_stmt*>(expr_o))
-            return m_visit_return(fexpr);
+    // script functions called from native code
+    object::value invoke(const object::value& fn, const object::value* args, std::size_t argc) override {
+        auto function = fn.as<object::callable<interpreter>>();
+        if (!function) throw skai::exception{"cannot perfrom call operation on a non-callable object"};
+        object::check_arity(*function, argc);
+        return function->call(*this, std::vector<object::value>(args, args + argc));
+    }
 
-        else if (auto fexpr = dynamic_cast<for_stmt*>(expr_o))
-            return m_visit_for(fexpr);
+    // runs a function body in a fresh frame, arguments occupy the first slots and defaults are evaluated inside of it
+    object::value m_call(const function_stmt& decl, const upvalues& up, const std::vector<object::value>& args) {
+        auto saved = m_push_frame(decl, up);
+        for (std::size_t i = 0; i < decl.arguments.size; ++i) {
+            const auto& arg = m_ast->get<argument_expr>(m_ast->nodes(decl.arguments)[i]);
+            m_define(arg.bind, i < args.size() ? args[i] : m_eval(arg.def));
+        }
 
-        else if (auto fexpr = dynamic_cast<while_stmt*>(expr_o))
-            return m_visit_while(fexpr);
+        bool was_in_func = in_func;
+        in_func = true;
+        m_exec_block(decl.body);
+        in_func = was_in_func;
+        break_after_ret = false;
+        m_pop_frame(saved);
+        return std::exchange(m_ret, object::value{});
+    }
 
-        else if (auto fexpr = dynamic_cast<block_stmt*>(expr_o))
-            return m_visit_block(fexpr);
+    // string literals are created once, like the constants of the vm
+    object::value m_literal(str_ref str) {
+        if (str >= m_literals.size()) m_literals.resize(str + 1);
+        auto& lit = m_literals[str];
+        if (lit.is_null()) lit = object::intern(m_ast->str(str));
+        return lit;
+    }
 
-        else if (auto fexpr = dynamic_cast<unary_expr*>(expr_o))
-            return m_visit_unary(fexpr);
+    object::value m_eval(node_ref ref) {
+        if (ref == 0) return object::value{};
+        ++m_nodes;
+
+        switch (m_ast->kind(ref)) {
+            case node_kind::call:
+                return m_visit_call(m_ast->get<call_expr>(ref));
+            case node_kind::binary:
+                return m_visit_binary_expr(m_ast->get<binary_expr>(ref));
+            case node_kind::access:
+                return m_visit_access(m_ast->get<access_expr>(ref));
+            case node_kind::logical:
+                return m_visit_logical(m_ast->get<logical_expr>(ref));
+            case node_kind::string:
+                return m_literal(m_ast->get<string_expr>(ref).value);
+            case node_kind::num:
+                return object::value::integer(m_ast->get<num_expr>(ref).value);
+            case node_kind::ldouble:
+                return object::value::floating(m_ast->get<ldouble_expr>(ref).value);
+            case node_kind::bool_:
+                return object::value::boolean(m_ast->get<bool_expr>(ref).value);
+            case node_kind::null:
+                return object::value{};
+            case node_kind::variable:
+                return m_visit_var(m_ast->get<variable_expr>(ref));
+            case node_kind::ident:
+                return m_visit_ident(m_ast->get<ident_expr>(ref));
+            case node_kind::assign:
+                return m_visit_assign(m_ast->get<assign_expr>(ref));
+            case node_kind::function:
+                return m_visit_func(ref);
+            case node_kind::lambda:
+                return m_closure(m_ast->get<lambda_expr>(ref).function);
+            case node_kind::if_:
+                return m_visit_if_stmt(m_ast->get<if_stmt>(ref));
+            case node_kind::return_:
+                return m_visit_return(m_ast->get<return_stmt>(ref));
+            case node_kind::for_:
+                return m_visit_for(m_ast->get<for_stmt>(ref));
+            case node_kind::while_:
+                return m_visit_while(m_ast->get<while_stmt>(ref));
+            case node_kind::iterate:
+                return m_visit_iterate(m_ast->get<iterate_stmt>(ref));
+            case node_kind::range: {
+                const auto& n = m_ast->get<range_expr>(ref);
+                auto begin = m_eval(n.begin);
+                auto end = m_eval(n.end);
+                return object::make<object::range>(begin, end, m_eval(n.step));
+            }
+            case node_kind::block:
+                return m_visit_block(m_ast->get<block_stmt>(ref));
+            case node_kind::unary:
+                return m_visit_unary(m_ast->get<unary_expr>(ref));
+            case node_kind::array:
+                return m_visit_arr(m_ast->get<array_expr>(ref));
+            case node_kind::dict:
+                return m_visit_dict(m_ast->get<dict_expr>(ref));
+            case node_kind::interpolation:
+                return m_visit_interpolation(m_ast->get<interpolation_expr>(ref));
+            case node_kind::subscript:
+                return m_visit_subsc(m_ast->get<subscript_expr>(ref));
+            case node_kind::slice:
+                return m_visit_slice(m_ast->get<slice_expr>(ref));
+            case node_kind::break_:
+                is_break = true;
+                break;
+            case node_kind::continue_:
+                is_continue = true;
+                break;
+            default:
+                break;
+        }
+        return object::value{};
+    }
 
-        else if (auto fexpr = dynamic_cast<array_expr*>(expr_o))
-            return m_visit_arr(fexpr);
+    // number of nodes evaluated so far, reported by '--stats'
+    std::uint64_t nodes_evaluated() const {
+        return m_nodes;
+    }
 
-        else if (auto fexpr = dynamic_cast<subscript_expr*>(expr_o))
-            return m_visit_subsc(fexpr);
+    // what a call has to restore once it returns
+    struct frame {
+        object::value* locals;
+        const upvalues* up;
+        std::size_t sp;
+    };
+
+    // the locals of a call live on the value stack, captured ones are boxed in cells that closures share
+    frame m_push_frame(const function_stmt& decl, const upvalues& up) {
+        if (m_depth >= max_frames || m_sp + decl.slots > m_stack.size()) throw skai::exception{"stack overflow"};
+        frame saved{m_locals, m_upvalues, m_sp};
+        ++m_depth;
+        m_upvalues = &up;
+        m_locals = m_stack.data() + m_sp;
+        m_sp += decl.slots;
+        return saved;
+    }
+    void m_pop_frame(const frame& saved) {
+        for (auto i = saved.sp; i < m_sp; ++i) m_stack[i] = object::value{};
+        --m_depth;
+        m_locals = saved.locals;
+        m_upvalues = saved.up;
+        m_sp = saved.sp;
+    }
 
-        else if (dynamic_cast<break_stmt*>(expr_o))
-            is_break = true;
+    void m_exec_block(list_ref stmts) {
+        for (auto elm : m_ast->nodes(stmts)) {
+            if (break_after_ret || is_break || is_continue) break;
+            m_eval(elm);
+        }
+    }
 
-        return std::make_shared<object::null>();
+    // the storage a resolved name refers to
+    object::value& m_slot(const binding& bind) {
+        switch (bind.where) {
+            case binding::storage::global:
+                return m_globals.get(static_cast<std::uint16_t>(bind.slot));
+            case binding::storage::local:
+                return m_locals[bind.slot];
+            case binding::storage::cell:
+                return static_cast<object::cell*>(m_locals[bind.slot].as_object())->value;
+            case binding::storage::upvalue:
+                break;
+        }
+        return (*m_upvalues)[bind.slot]->value;
     }
 
-    void m_exec_block(const std::vector<std::shared_ptr<expr>>& exprs, const scope<object::object>& sc, bool is_a_fnc) {
-        if (is_a_fnc) {
-            auto prev = m_env.get_contents();
-            m_env.set_contents(sc.get_contents());
-            for (const auto& elm : exprs) {
-                if (break_after_ret) break;
-                m_eval(elm);
-            }
-            m_env.set_contents(prev);
-        } else {
-            for (const auto& elm : exprs) { m_eval(elm); }
+    // binds a declaration, a captured local gets a fresh cell every time its declaration runs
+    void m_define(const binding& bind, const object::value& value, bool is_const = false) {
+        switch (bind.where) {
+            case binding::storage::global:
+                m_globals.values[bind.slot] = value;
+                m_globals.is_const[bind.slot] = is_const;
+                break;
+            case binding::storage::local:
+                m_locals[bind.slot] = value;
+                break;
+            case binding::storage::cell:
+                m_locals[bind.slot] = object::make<object::cell>(value);
+                break;
+            case binding::storage::upvalue:
+                break;
         }
     }
 
-    std::shared_ptr<object::object> m_visit_ident(ident_expr* idex) {
-        return m_env.get(idex->name);
+    object::value m_visit_ident(const ident_expr& idex) {
+        return m_slot(idex.bind);
     }
 
-    std::shared_ptr<object::object> m_visit_arr(array_expr* aexpr) {
-        std::vector<std::shared_ptr<object::object>> vals;
-        for (auto e : aexpr->elements) vals.push_back(m_eval(e));
-        return std::make_shared<object::array>(vals);
+    object::value m_visit_arr(const array_expr& aexpr) {
+        std::vector<object::value> vals;
+        vals.reserve(aexpr.elements.size);
+        for (auto e : m_ast->nodes(aexpr.elements)) vals.push_back(m_eval(e));
+        return object::make<object::array>(std::move(vals));
     }
 
-    std::shared_ptr<object::object> m_visit_var(variable_expr* var) {
-        std::shared_ptr<object::object> value = std::make_shared<object::null>();
-        if (var->value != nullptr) value = m_eval(var->value);
-        m_env.define(var->name, std::make_shared<object::variable>(var->name, var->is_const, value));
-        return std::make_shared<object::null>();
+    object::value m_visit_dict(const dict_expr& dexpr) {
+        auto map = object::make<object::dict>();
+        auto entries = m_ast->nodes(dexpr.entries);
+        for (std::size_t i = 0; i < entries.size(); i += 2) {
+            auto key = m_eval(entries[i]);
+            map->set(key, m_eval(entries[i + 1]));
+        }
+        return map;
     }
 
-    std::shared_ptr<object::object> m_visit_call(call_expr* cexpr) {
-        auto callee = m_eval(cexpr->callee);
-        std::vector<std::shared_ptr<object::object>> args;
-        for (auto& arg : cexpr->arguments) args.push_back(m_eval(arg));
-        if (auto function = dynamic_cast<object::callable<interpreter>*>(callee.get())) {
-            if (!function->variadic()) {
-                if (args.size() < function->mina() || args.size() > function->maxa()) {
-                    std::string pref = args.size() > function->maxa()  ? fmt::format("at most '{}' argument", function->maxa())
-                                       : args.size() < function->mina() ? fmt::format("at least '{}' argument", function->mina())
-                                                         : fmt::format("'{}' argument", function->maxa());
+    // the parts are evaluated into slots above the current frame, calls made by the parts push their frames after them
+    object::value m_visit_interpolation(const interpolation_expr& interp) {
+        if (m_sp + interp.parts.size > m_stack.size()) throw skai::exception{"stack overflow"};
+        auto base = m_sp;
+        m_sp += interp.parts.size;
+        auto* parts = m_stack.data() + base;
+        for (auto part : m_ast->nodes(interp.parts)) *parts++ = m_eval(part);
+        auto result = object::interpolate(m_stack.data() + base, interp.parts.size);
+        for (auto i = base; i < m_sp; ++i) m_stack[i] = object::value{};
+        m_sp = base;
+        return result;
+    }
 
-                    throw skai::exception{
-                        fmt::format("unmatched arguments count, expected {}, got {} instead", pref, args.size())};
-                }
-            }
+    object::value m_visit_var(const variable_expr& var) {
+        object::value value{};
+        if (var.value != 0) value = m_eval(var.value);
+        m_define(var.bind, value, var.is_const);
+        return object::value{};
+    }
+
+    object::value m_visit_call(const call_expr& cexpr) {
+        // 'target.name(args...)' calls a method of the target
+        if (m_ast->kind(cexpr.callee) == node_kind::access) {
+            const auto& access = m_ast->get<access_expr>(cexpr.callee);
+            auto target = m_eval(access.target);
+            std::vector<object::value> args;
+            args.reserve(cexpr.arguments.size);
+            for (auto arg : m_ast->nodes(cexpr.arguments)) args.push_back(m_eval(arg));
+            const auto& name = m_ast->str(m_ast->get<ident_expr>(access.object).name);
+            return object::call_method(target, name, args.data(), args.size(), *this);
+        }
+        auto callee = m_eval(cexpr.callee);
+        std::vector<object::value> args;
+        args.reserve(cexpr.arguments.size);
+        for (auto arg : m_ast->nodes(cexpr.arguments)) args.push_back(m_eval(arg));
+        if (auto function = callee.as<object::callable<interpreter>>()) {
+            object::check_arity(*function, args.size());
             return function->call(*this, args);
         }
         throw skai::exception{"cannot perfrom call operation on a non-callable object"};
     }
 
-    std::shared_ptr<object::object> m_visit_assign(assign_expr* aexpr) {
-        if (auto ident = dynamic_cast<object::variable*>(m_eval(aexpr->lhs).get())) {
-            if (ident->is_const) throw skai::exception{fmt::format("assigning to const variable '{}'", ident->name)};
-            auto new_value = m_eval(aexpr->rhs);
-            m_env.assign(ident->name, std::make_shared<object::variable>(ident->name, false, new_value));
-            return std::make_shared<object::null>();
+    object::value m_visit_assign(const assign_expr& aexpr) {
+        if (m_ast->kind(aexpr.lhs) == node_kind::subscript) {
+            const auto& sexpr = m_ast->get<subscript_expr>(aexpr.lhs);
+            auto target = m_eval(sexpr.object);
+            auto idx = m_eval(sexpr.target);
+            auto new_value = m_eval(aexpr.rhs);
+            if (!target.is_object())
+                throw skai::exception{fmt::format("'{}' does not support item assignment", target.type_to_string())};
+            target.as_object()->set_subscript(idx, new_value);
+            return new_value;
         }
-        throw skai::exception{"invalid operand for '='"};
+        auto new_value = m_eval(aexpr.rhs);
+        // const locals are rejected by the resolver, const globals are only known at runtime
+        if (aexpr.bind.where == binding::storage::global)
+            m_globals.assign(static_cast<std::uint16_t>(aexpr.bind.slot), new_value);
+        else
+            m_slot(aexpr.bind) = new_value;
+        return new_value;
+    }
+
+    object::value m_visit_access(const access_expr&) {
+        throw skai::exception{"member access is not supported yet"};
     }
 
-    std::shared_ptr<object::object> m_visit_access(access_expr* aexpr) {
-        auto left = m_eval(aexpr->target);
+    object::value m_visit_slice(const slice_expr& sexpr) {
+        auto target = m_eval(sexpr.object);
+        auto begin = sexpr.begin != 0 ? m_eval(sexpr.begin) : object::value{};
+        auto end = sexpr.end != 0 ? m_eval(sexpr.end) : object::value{};
+        if (!target.is_object()) throw skai::exception{fmt::format("'{}' can't be sliced", target.type_to_string())};
+        return target.as_object()->slice(begin, end);
     }
 
-    std::shared_ptr<object::object> m_visit_subsc(subscript_expr* sexpr) {
-        return m_eval(sexpr->object)->operator[](m_eval(sexpr->target));
+    object::value m_visit_subsc(const subscript_expr& sexpr) {
+        auto target = m_eval(sexpr.object);
+        if (!target.is_object())
+            throw skai::exception{fmt::format("'{}' is not subscriptable", target.type_to_string())};
+        return target.as_object()->subscript(m_eval(sexpr.target));
     }
 
-    std::shared_ptr<object::object> m_visit_if_stmt(if_stmt* stmt) {
-        if (stmt->init != nullptr) m_eval(stmt->init);
-        if (m_to_bool(m_eval(stmt->condition))) {
-            m_eval(stmt->then_branch);
+    object::value m_visit_if_stmt(const if_stmt& stmt) {
+        if (stmt.init != 0) m_eval(stmt.init);
+        if (m_to_bool(m_eval(stmt.condition))) {
+            m_eval(stmt.then_branch);
 
-        } else if (stmt->else_branch != nullptr) {
-            m_eval(stmt->else_branch);
+        } else if (stmt.else_branch != 0) {
+            m_eval(stmt.else_branch);
         }
-        return std::make_shared<object::null>();
+        return object::value{};
     }
 
-    std::shared_ptr<object::object> m_visit_while(while_stmt* stmt) {
+    object::value m_visit_while(const while_stmt& stmt) {
         within_a_loop = true;
-        if (stmt->init != nullptr) m_eval(stmt->init);
-        while (m_to_bool(m_eval(stmt->branch)) && !is_break) { m_eval(stmt->body); }
+        if (stmt.init != 0) m_eval(stmt.init);
+        while (m_to_bool(m_eval(stmt.branch))) {
+            m_eval(stmt.body);
+            if (m_end_iteration()) break;
+        }
         within_a_loop = false;
-        return std::make_shared<object::null>();
+        return object::value{};
     }
 
-    std::shared_ptr<object::object> m_visit_for(for_stmt* stmt) {
+    object::value m_visit_for(const for_stmt& stmt) {
         within_a_loop = true;
-        for (auto init = m_eval(stmt->init); m_to_bool(m_eval(stmt->condition)) && !is_break;
-             init = m_eval(stmt->branch))
-            m_eval(stmt->body);
+        for (auto init = m_eval(stmt.init); m_to_bool(m_eval(stmt.condition)); init = m_eval(stmt.branch)) {
+            m_eval(stmt.body);
+            if (m_end_iteration()) break;
+        }
 
         within_a_loop = false;
-        return std::make_shared<object::null>();
-    }
-
-    std::shared_ptr<object::object> m_visit_block(block_stmt* block) {
-        m_exec_block(block->stmts, m_env, false);
-        return std::make_shared<object::null>();
-    }
-
-    std::shared_ptr<object::object> m_visit_unary(unary_expr* uexpr) {
-        auto target = m_eval(uexpr->operand);
-        switch (uexpr->op) {
-            case token::minus:
-                if (auto i = dynamic_cast<object::integer*>(target.get())) {
-                    return std::make_shared<object::integer>(-i->value);
-                }
-                throw skai::exception{"invalid operand for token '-'"};
-            case token::plus:
-                if (auto i = dynamic_cast<object::integer*>(target.get())) {
-                    return std::make_shared<object::integer>(+i->value);
-                }
-                throw skai::exception{"invalid operand for token '+'"};
-            case token::not_:
-                if (auto i = dynamic_cast<object::boolean*>(target.get())) {
-                    return std::make_shared<object::boolean>(!i->value);
-                }
-                throw skai::exception{"invalid operand for token '!'"};
+        return object::value{};
+    }
+
+    object::value m_visit_iterate(const iterate_stmt& stmt) {
+        within_a_loop = true;
+        auto iterable = m_eval(stmt.iterable);
+        std::int64_t cursor = 0;
+        m_define(stmt.bind, object::value{});
+        while (object::next(iterable, cursor, m_slot(stmt.bind))) {
+            m_eval(stmt.body);
+            if (m_end_iteration()) break;
         }
+        within_a_loop = false;
+        return object::value{};
+    }
+
+    // resets the loop control flags after one iteration, returns true if the loop has to stop
+    bool m_end_iteration() {
+        is_continue = false;
+        if (is_break) {
+            is_break = false;
+            return true;
+        }
+        return break_after_ret;
+    }
+
+    object::value m_visit_block(const block_stmt& block) {
+        m_exec_block(block.stmts);
+        return object::value{};
     }
 
-    std::shared_ptr<object::object> m_visit_return(return_stmt* rtst) {
+    object::value m_visit_unary(const unary_expr& uexpr) {
+        return object::unary(uexpr.op, m_eval(uexpr.operand));
+    }
+
+    object::value m_visit_return(const return_stmt& rtst) {
         if (!in_func) throw skai::exception{"return statements are only valid in functions definitions"};
-        m_ret = m_eval(rtst->value);
+        m_ret = m_eval(rtst.value);
         break_after_ret = true;
         return m_ret;
     }
 
-    std::shared_ptr<object::object> m_visit_func(function_stmt* ftst) {
-        auto fnc = std::make_shared<object::function<interpreter>>(*ftst, m_env, ftst->name == "init");
+    object::value m_visit_func(node_ref ref) {
+        const auto& ftst = m_ast->get<function_stmt>(ref);
+        // the name is bound first, a function that calls itself captures its own cell
+        m_define(ftst.bind, object::value{});
+        m_slot(ftst.bind) = m_closure(ref);
         break_after_ret = false;
-        m_env.define(ftst->name, fnc);
-        fnc->env = m_env;
-        return std::make_shared<object::null>();
+        return object::value{};
+    }
+    object::value m_closure(node_ref ref) {
+        const auto& ftst = m_ast->get<function_stmt>(ref);
+        upvalues up;
+        up.reserve(ftst.captures.size);
+        for (const auto& cap : m_ast->captures(ftst.captures)) {
+            up.push_back(cap.is_local ? static_cast<object::cell*>(m_locals[cap.index].as_object())
+                                      : (*m_upvalues)[cap.index]);
+        }
+        return object::make<object::function<interpreter>>(m_ast, ref, std::move(up));
     }
 
-    /*std::shared_ptr<object::object> m_visit_class(class_expr* cexpr) {
+    /*object::value m_visit_class(const class_expr& cexpr) {
         auto sc = m_env;
-        m_exec_block(cexpr->members, sc, false);
-        m_env.define(cexpr->name, std::make_shared<object::class_o<interpreter>>(cexpr->name, sc));
-        return std::make_shared<object::null>();
+        m_exec_block(cexpr.members, sc, false);
+        m_env.define(cexpr.name, std::make_shared<object::class_o<interpreter>>(cexpr.name, sc));
+        return object::value{};
     }
 */
-    bool m_to_bool(const std::shared_ptr<object::object>& obj) {
-        if (dynamic_cast<object::null*>(obj.get())) {
+    bool m_to_bool(const object::value& obj) {
+        if (obj.is_null()) {
             return false;
-        } else if (auto b = dynamic_cast<object::boolean*>(obj.get())) {
-            return b->value;
+        } else if (obj.is_bool()) {
+            return obj.as_bool();
         }
         throw skai::exception{"implicit conversions to booleans are disallowed"};
     }
 
-    std::shared_ptr<object::object> m_visit_binary_expr(binary_expr* bin) {
-        auto left = m_eval(bin->lhs);
-        auto right = m_eval(bin->rhs);
-#define OP_(tok, op) \
-    case token::tok: \
-        return left.get()->operator op(right);
-
-#define OP(tok, op) \
-    OP_(tok, op)    \
-    OP_(tok##_eq, op## =)
-
-        switch (bin->op) {
-            OP(plus, +)
-            OP(minus, -)
-            OP(star, *)
-            OP(slash, /)
-            OP(b_or, |)
-            OP(b_and, &)
-            OP(mod, %)
-            OP_(d_eq, ==)
-            OP_(not_eq_, !=)
-            OP(gt, >)
-            OP(lt, <)
+    object::value m_visit_binary_expr(const binary_expr& bin) {
+        if (auto op = compound_base(bin.op); op != bin.op) {
+            const auto& bind = m_ast->get<ident_expr>(bin.lhs).bind;
+            auto rhs = m_eval(bin.rhs);
+            auto& slot = m_slot(bind);
+            if (bind.where == binding::storage::global && m_globals.is_const[bind.slot])
+                throw skai::exception{fmt::format("assigning to const variable '{}'", m_globals.names[bind.slot])};
+            object::binary_assign(op, slot, rhs);
+            return slot;
         }
+        // a temporary on the left (the result of another '+') is extended in place
+        auto left = m_eval(bin.lhs);
+        object::binary_assign(bin.op, left, m_eval(bin.rhs));
+        return left;
     }
 
-    std::shared_ptr<object::object> m_visit_logical(logical_expr* expr_) {
-        auto left = m_to_bool(m_eval(expr_->lhs));
-        auto right = m_to_bool(m_eval(expr_->rhs));
-        switch (expr_->op) {
+    object::value m_visit_logical(const logical_expr& expr_) {
+        auto left = m_to_bool(m_eval(expr_.lhs));
+        switch (expr_.op) {
             case token::and_:
-                return std::make_shared<object::boolean>(left && right);
+                return object::value::boolean(left && m_to_bool(m_eval(expr_.rhs)));
             case token::or_:
-                return std::make_shared<object::boolean>(left || right);
+                return object::value::boolean(left || m_to_bool(m_eval(expr_.rhs)));
         }
-        return std::make_shared<object::boolean>(false);
+        return object::value::boolean(false);
     }
 
-    std::shared_ptr<object::object> get_return() {
+    object::value get_return() {
         return m_ret;
     }
-    void set_ret(std::shared_ptr<object::object> obj) {
+    void set_ret(object::value obj) {
         m_ret = obj;
     }
-    scope<object::object> get_env() {
-        return m_env;
-    }
-
     void set_in_func(bool x) {
         in_func = x;
     }
@@ -315,11 +475,18 @@ struct interpreter {
     }
 
    private:
-    scope<object::object> m_globals;
-    std::vector<std::shared_ptr<expr>> m_tokens;
-    std::shared_ptr<object::object> m_ret;
-    scope<object::object> m_env;
+    global_table<object::value> m_globals;
+    const ast* m_ast{};
+    std::vector<object::value> m_literals;
+    object::value m_ret;
+    std::vector<object::value> m_stack;
+    std::size_t m_sp{};
+    std::size_t m_depth{};
+    std::uint64_t m_nodes{};
+    object::value* m_locals{};
+    const upvalues* m_upvalues{};
     bool is_break{};
+    bool is_continue{};
     bool within_a_loop{};
     bool break_after_ret{};
     bool in_func{};
@@ -2,14 +2,17 @@
 #define SKAI_LEXER_HPP_73399393
 #include <fmt/format.h>
 
+#include <cctype>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
 #include "error.hpp"
 #include "sloc.hpp"
 namespace skai {
-enum class token {
+enum class token : std::uint8_t {
     eq,
     d_eq,
     gt,
@@ -69,6 +72,9 @@ enum class token {
     lcbracket,
     rcbracket,
     string,
+    // the text of a string literal up to a '${', the embedded expression follows and the literal continues with
+    // another 'string_part' or ends with a 'string'
+    string_part,
     identifier,
     negate,
     number,
@@ -76,31 +82,135 @@ enum class token {
     range
 };
 
+// spelling of operator tokens, used in error messages
+inline const char* token_str(token tok) {
+    switch (tok) {
+        case token::eq:
+            return "=";
+        case token::d_eq:
+            return "==";
+        case token::gt:
+            return ">";
+        case token::gt_eq:
+            return ">=";
+        case token::lt:
+            return "<";
+        case token::lt_eq:
+            return "<=";
+        case token::not_:
+            return "!";
+        case token::not_eq_:
+            return "!=";
+        case token::and_:
+            return "and";
+        case token::or_:
+            return "or";
+        case token::plus:
+            return "+";
+        case token::plus_eq:
+            return "+=";
+        case token::minus:
+            return "-";
+        case token::minus_eq:
+            return "-=";
+        case token::star:
+            return "*";
+        case token::star_eq:
+            return "*=";
+        case token::slash:
+            return "/";
+        case token::slash_eq:
+            return "/=";
+        case token::mod:
+            return "%";
+        case token::mod_eq:
+            return "%=";
+        case token::xor_:
+            return "^";
+        case token::xor_eq_:
+            return "^=";
+        case token::b_or:
+            return "|";
+        case token::b_or_eq:
+            return "|=";
+        case token::lshift:
+            return "<<";
+        case token::lshift_eq:
+            return "<<=";
+        case token::rshift:
+            return ">>";
+        case token::rshift_eq:
+            return ">>=";
+        case token::b_and:
+            return "&";
+        case token::b_and_eq:
+            return "&=";
+        case token::negate:
+            return "~";
+        case token::range:
+            return "..";
+    }
+    return "?";
+}
+
+// operator applied by a compound assignment ('+=' -> '+'), returns the token itself for anything else
+inline token compound_base(token tok) {
+    switch (tok) {
+        case token::plus_eq:
+            return token::plus;
+        case token::minus_eq:
+            return token::minus;
+        case token::star_eq:
+            return token::star;
+        case token::slash_eq:
+            return token::slash;
+        case token::mod_eq:
+            return token::mod;
+        case token::xor_eq_:
+            return token::xor_;
+        case token::b_or_eq:
+            return token::b_or;
+        case token::lshift_eq:
+            return token::lshift;
+        case token::rshift_eq:
+            return token::rshift;
+        case token::b_and_eq:
+            return token::b_and;
+    }
+    return tok;
+}
+
+// 16 bytes, the lexeme is not copied, 'text()' of the source file gives it back
 struct token_handler {
     token tok;
-    std::string str;
+    std::uint32_t length;
     skai::source_location loc;
     template <class... tok_>
-    bool is(tok_... t) {
+    bool is(tok_... t) const {
         return (... || (tok == t));
     }
 
     template <class... tok_>
-    bool isnot(tok_... t) {
+    bool isnot(tok_... t) const {
         return !is(t...);
     }
+    // for string literals it's the text between the quotes
+    std::string_view text(const source_file& src) const {
+        return src.text().substr(loc.offset, length);
+    }
 };
 
-static std::unordered_map<std::string, token> keywords{
+static const std::unordered_map<std::string_view, token> keywords{
     {"and", token::and_},       {"or", token::or_},     {"if", token::if_},       {"imm", token::imm},
     {"fnc", token::fun},        {"let", token::let},    {"class", token::class_}, {"while", token::while_},
     {"for", token::for_},       {"else", token::else_}, {"break", token::break_}, {"continue", token::continue_},
     {"return", token::return_}, {"true", token::true_}, {"false", token::false_}, {"of", token::of},
     {"null", token::null},      {"lm", token::lm}};
 struct lexer {
-    lexer(const std::string& str, const std::string& name) : m_inp{str}, m_file{name} {}
+    lexer(const source_file& src) : m_inp{src.text()}, m_file{src.id} {}
 
     void scan() {
+        m_start = m_pos;
         switch (m_get()) {
             default:
                 if (std::isdigit(static_cast<unsigned char>(m_get()))) {
@@ -116,9 +226,18 @@ struct lexer {
                 m_addtok(token::lparen);
                 break;
             case '}':
+                // the brace closing a '${' resumes the string literal
+                if (!m_braces.empty() && m_braces.back() == 0) {
+                    m_braces.pop_back();
+                    m_advance();
+                    m_string();
+                    break;
+                }
+                if (!m_braces.empty()) --m_braces.back();
                 m_addtok(token::rbracket);
                 break;
             case '{':
+                if (!m_braces.empty()) ++m_braces.back();
                 m_addtok(token::lbracket);
                 break;
             case ']':
@@ -128,7 +247,7 @@ struct lexer {
                 m_addtok(token::lcbracket);
                 break;
             case '.':
-                m_addtok(token::dot);
+                m_addtok(m_next('.') ? token::range : token::dot);
                 break;
             case ',':
                 m_addtok(token::comma);
@@ -143,126 +262,74 @@ struct lexer {
                 m_addtok(token::colon);
                 break;
             case '*':
-                if (m_peek() == '=') {
-                    m_advance();
-                    m_addtok(token::star_eq, "*=");
-                } else {
-                    m_addtok(token::star);
-                }
+                m_addtok(m_next('=') ? token::star_eq : token::star);
                 break;
             case '+':
-                if (m_peek() == '=') {
-                    m_advance();
-                    m_addtok(token::plus_eq, "+=");
-                } else {
-                    m_addtok(token::plus);
-                }
+                m_addtok(m_next('=') ? token::plus_eq : token::plus);
                 break;
             case '%':
-                if (m_peek() == '=') {
-                    m_advance();
-                    m_addtok(token::mod_eq, "%=");
-                } else {
-                    m_addtok(token::mod);
-                }
+                m_addtok(m_next('=') ? token::mod_eq : token::mod);
                 break;
             case ' ':
             case '\t':
             case '\r':
-                break;
             case '\n':
-                ++m_line;
                 break;
             case '^':
-                if (m_peek() == '=') {
-                    m_advance();
-                    m_addtok(token::xor_eq_, "^=");
-                } else {
-                    m_addtok(token::xor_);
-                }
+                m_addtok(m_next('=') ? token::xor_eq_ : token::xor_);
                 break;
             case '&':
-                if (m_peek() == '=') {
-                    m_advance();
-                    m_addtok(token::b_and_eq, "&=");
-                } else if (m_peek() == '&') {
-                    m_addtok(token::and_, "&&");
-                    m_advance();
-                } else {
+                if (m_next('='))
+                    m_addtok(token::b_and_eq);
+                else if (m_next('&'))
+                    m_addtok(token::and_);
+                else
                     m_addtok(token::b_and);
-                }
                 break;
             case '|':
-                if (m_peek() == '=') {
-                    m_advance();
-                    m_addtok(token::b_or_eq, "|=");
-                } else if (m_peek() == '|') {
-                    m_addtok(token::or_, "||");
-                    m_advance();
-                } else {
+                if (m_next('='))
+                    m_addtok(token::b_or_eq);
+                else if (m_next('|'))
+                    m_addtok(token::or_);
+                else
                     m_addtok(token::b_or);
-                }
                 break;
             case '-':
-                if (m_peek() == '=') {
-                    m_advance();
+                if (m_next('='))
                     m_addtok(token::minus_eq);
-                } else if (m_peek() == '>') {
-                    m_addtok(token::arrow, "->");
-                    m_advance();
-                } else {
+                else if (m_next('>'))
+                    m_addtok(token::arrow);
+                else
                     m_addtok(token::minus);
-                }
                 break;
             case '/':
                 if (m_peek() == '/') {
-                    m_advance();
-                    do { m_advance(); } while (m_get() != '\n');
-                    break;
-                } else if (m_peek() == '=') {
-                    m_advance();
-                    m_addtok(token::slash_eq, "/=");
+                    while (!at_end() && m_get() != '\n') m_advance();
                 } else {
-                    m_addtok(token::slash);
+                    m_addtok(m_next('=') ? token::slash_eq : token::slash);
                 }
                 break;
             case '!':
-                if (m_peek() == '=') {
-                    m_addtok(token::not_eq_, "!=");
-                    m_advance();
-                } else {
-                    m_addtok(token::not_);
-                }
+                m_addtok(m_next('=') ? token::not_eq_ : token::not_);
                 break;
             case '=':
-                if (m_peek() == '=') {
-                    m_addtok(token::d_eq, "==");
-                    m_advance();
-                } else {
-                    m_addtok(token::eq);
-                }
+                m_addtok(m_next('=') ? token::d_eq : token::eq);
                 break;
             case '<':
-                if (m_peek() == '=') {
-                    m_addtok(token::lt_eq, "<=");
-                    m_advance();
-                } else if (m_peek() == '<') {
-                    m_addtok(token::lshift, "<<");
-                    m_advance();
-                } else {
+                if (m_next('='))
+                    m_addtok(token::lt_eq);
+                else if (m_next('<'))
+                    m_addtok(m_next('=') ? token::lshift_eq : token::lshift);
+                else
                     m_addtok(token::lt);
-                }
                 break;
             case '>':
-                if (m_peek() == '=') {
-                    m_addtok(token::gt_eq, ">=");
-                    m_advance();
-                } else if (m_peek() == '>') {
-                    m_addtok(token::rshift, ">>");
-                    m_advance();
-                } else {
+                if (m_next('='))
+                    m_addtok(token::gt_eq);
+                else if (m_next('>'))
+                    m_addtok(m_next('=') ? token::rshift_eq : token::rshift);
+                else
                     m_addtok(token::gt);
-                }
                 break;
             case '"':
                 m_advance();
@@ -273,8 +340,11 @@ struct lexer {
     }
 
     auto lex() {
+        // tokens average more than two characters with their spacing, the reservation avoids regrowing the vector on big
+        // inputs and the part that stays unused is never touched
+        m_out.reserve(m_inp.size() / 2 + 1);
         while (!at_end()) { scan(); }
-        return m_out;
+        return std::move(m_out);
     }
 
    private:
@@ -282,74 +352,62 @@ struct lexer {
         m_pos += x;
     }
     char m_peek(std::size_t x = 1) {
-        return ((m_pos + x) >= m_inp.size() ? '\0' : m_inp.at(m_pos + x));
+        return ((m_pos + x) >= m_inp.size() ? '\0' : m_inp[m_pos + x]);
     }
-    char m_previous(std::size_t x = 1) {
-        return m_peek(m_pos - x);
+    // consumes the next character if it is 'c', for two character operators
+    bool m_next(char c) {
+        if (m_peek() != c) return false;
+        m_advance();
+        return true;
     }
     bool at_end() {
         return m_pos >= m_inp.size();
     }
     char m_get() {
-        return (at_end() ? '\0' : m_inp.at(m_pos));
+        return (at_end() ? '\0' : m_inp[m_pos]);
     }
+    // the token spans from the start of the current scan up to the current character
     void m_addtok(token tok) {
-        m_out.push_back(token_handler{tok, std::string(1, m_get()), {m_file, m_line, m_pos}});
+        m_addtok(tok, m_start, m_pos + 1);
     }
-    void m_addtok(token tok, std::string str) {
-        m_out.push_back(token_handler{tok, str, {m_file, m_line, m_pos}});
+    void m_addtok(token tok, std::size_t begin, std::size_t end) {
+        m_out.push_back(token_handler{tok, static_cast<std::uint32_t>(end - begin),
+                                      {m_file, static_cast<std::uint32_t>(begin)}});
     }
+    // scans from the character after the opening quote (or after the '}' ending an interpolation)
     void m_string() {
-        std::string full;
-    br : {
-        while (m_get() != '"' && !at_end()) {
-            full.push_back(m_get());
-            m_advance();
-        }
-    }
-        if (full.back() == '\\') {
-            full.push_back('"');
-            m_advance();
-            goto br;
-        }
+        // escapes are skipped as a pair so that '\\' before the closing quote ends the literal, the parser decodes them
+        while (!at_end() && m_get() != '"' && (m_get() != '$' || m_peek() != '{')) m_advance(m_get() == '\\' ? 2 : 1);
         if (at_end()) { throw skai::exception{"unterminated string literal '\"'"}; }
-        m_addtok(token::string, full);
+        if (m_get() == '"') return m_addtok(token::string, m_start + 1, m_pos);
+        m_addtok(token::string_part, m_start + 1, m_pos);
+        m_advance();
+        m_braces.push_back(0);
     }
     void m_number() {
-        std::string full;
         bool is_double{};
         while (std::isdigit(static_cast<unsigned char>(m_get())) || m_get() == '.') {
-            if (m_get() == '.' && is_double) break;
+            // '1..5' is a range
+            if (m_get() == '.' && (is_double || m_peek() == '.')) break;
             if (m_get() == '.') is_double = true;
-            full.push_back(m_get());
             m_advance();
         }
-        if (is_double && full.back() != '.') {
-            if (std::count(full.begin(), full.end(), '.') > 1) throw skai::exception{"invalid float value"};
-            m_addtok(token::double_, full);
+        if (is_double && m_inp[m_pos - 1] != '.') {
+            m_addtok(token::double_, m_start, m_pos);
         } else {
             // since everything is almost an object we make sure the access operator '.' get's lexed separately from the
             // number and not treated as a double
-            bool ends_with_dot = full.back() == '.';
-            if (ends_with_dot) full.pop_back();
-            m_addtok(token::number, full);
-            if (ends_with_dot) m_addtok(token::dot, ".");
+            bool ends_with_dot = m_inp[m_pos - 1] == '.';
+            m_addtok(token::number, m_start, m_pos - ends_with_dot);
+            if (ends_with_dot) m_addtok(token::dot, m_pos - 1, m_pos);
         }
         m_advance(-1);
     }
 
     void m_ident() {
-        std::string full;
-        while (std::isdigit(static_cast<unsigned char>(m_get())) || m_alph(m_get())) {
-            full.push_back(m_get());
-            m_advance();
-        }
-        auto key = keywords.find(full);
-        if (key != keywords.end()) {
-            m_addtok(key->second, full);
-        } else {
-            m_addtok(token::identifier, full);
-        }
+        while (std::isdigit(static_cast<unsigned char>(m_get())) || m_alph(m_get())) m_advance();
+        auto key = keywords.find(m_inp.substr(m_start, m_pos - m_start));
+        m_addtok(key != keywords.end() ? key->second : token::identifier, m_start, m_pos);
         m_advance(-1);
     }
 
@@ -358,10 +416,12 @@ struct lexer {
     }
 
     std::vector<token_handler> m_out;
-    std::size_t m_line = 1;
+    // braces opened inside each '${' that is being scanned, innermost last
+    std::vector<std::uint32_t> m_braces;
+    std::size_t m_start = 0;
     std::size_t m_pos = 0;
-    const std::string m_inp;
-    const std::string m_file;
+    const std::string_view m_inp;
+    const std::uint32_t m_file;
 };
 }  // namespace skai
 #endif
@@ -20,50 +20,93 @@ namespace skai {
 namespace builtins {
 
 SK_FUNC(print, 1, 255, true, args) {
-    for (const auto& arg : args) { std::printf("%s ", arg->to_string().c_str()); }
+    for (const auto& arg : args) {
+        // strings are written as they are stored, without a copy and including any '\0'
+        if (arg.id() == object::type_id::string) {
+            auto str = static_cast<object::string*>(arg.as_object())->view();
+            std::fwrite(str.data(), 1, str.size(), stdout);
+        } else {
+            auto str = arg.to_string();
+            std::fwrite(str.data(), 1, str.size(), stdout);
+        }
+        std::putchar(' ');
+    }
     std::putchar('\n');
-    return std::make_shared<object::null>();
+    return object::value{};
 }
 SK_FUNC_END
 
 SK_FUNC(prompt, 1, 1, false, args) {
-    auto str = dynamic_cast<object::string*>(args.at(0).get());
+    auto str = args.at(0).template as<object::string>();
     if (!str) throw skai::exception{"'prompt' expected string as a first argument"};
     std::string value;
-    std::cout << str->value;
+    std::cout << str->view();
     std::getline(std::cin, value);
-    return std::make_shared<object::string>(value);
+    return object::make<object::string>(value);
 }
 SK_FUNC_END
 
 SK_FUNC(time, 0, 0, false, ) {
-    return std::make_shared<object::ldouble>(std::chrono::system_clock::now().time_since_epoch().count() / 1000.0);
+    return object::value::floating(std::chrono::system_clock::now().time_since_epoch().count() / 1000.0);
+}
+SK_FUNC_END
+
+// collects both generations right away, returns the number of objects freed
+SK_FUNC(gc, 0, 0, false, ) {
+    return object::value::integer(static_cast<std::int64_t>(object::cycles.collect(true)));
 }
 SK_FUNC_END
 
 SK_FUNC(sleep, 1, 1, false, args) {
-    auto amn = dynamic_cast<object::integer*>(args.at(0).get());
-    if (!amn) throw skai::exception{"'sleep' expected integer as a first argument"};
-    std::this_thread::sleep_for(std::chrono::milliseconds(amn->value));
-    return std::make_shared<object::null>();
+    if (!args.at(0).is_int()) throw skai::exception{"'sleep' expected integer as a first argument"};
+    std::this_thread::sleep_for(std::chrono::milliseconds(args.at(0).as_int()));
+    return object::value{};
 }
 SK_FUNC_END
 
 SK_FUNC(random, 2, 2, false, args) {
     std::random_device mt{};
-    if (auto [f, l] = std::tuple{dynamic_cast<object::integer*>(args.at(0).get()),
-                                 dynamic_cast<object::integer*>(args.at(1).get())};
-        f && l) {
-        if (l->value < f->value) throw skai::exception{"'random' invalid range provided"};
-        std::uniform_int_distribution<std::int64_t> un(f->value, l->value);
-        return std::make_shared<object::integer>(un(mt));
+    if (const auto& [f, l] = std::tie(args.at(0), args.at(1)); f.is_int() && l.is_int()) {
+        if (l.as_int() < f.as_int()) throw skai::exception{"'random' invalid range provided"};
+        std::uniform_int_distribution<std::int64_t> un(f.as_int(), l.as_int());
+        return object::value::integer(un(mt));
     }
     throw skai::exception{"random: expected integer types"};
 }
 SK_FUNC_END
 
 SK_FUNC(type_of, 1, 1, false, args) {
-    return std::make_shared<object::string>(args.at(0)->type_to_string());
+    return object::make<object::string>(args.at(0).type_to_string());
+}
+SK_FUNC_END
+
+SK_FUNC(len, 1, 1, false, args) {
+    const auto& arg = args.at(0);
+    if (arg.id() == object::type_id::string)
+        return object::value::integer(static_cast<object::string*>(arg.as_object())->view().size());
+    if (arg.id() == object::type_id::array)
+        return object::value::integer(static_cast<object::array*>(arg.as_object())->size());
+    if (arg.id() == object::type_id::dict)
+        return object::value::integer(static_cast<object::dict*>(arg.as_object())->size());
+    if (auto pipe = arg.template as<object::pipeline>()) return object::value::integer(pipe->collect()->size());
+    if (auto r = arg.template as<object::range>()) return object::value::integer(static_cast<std::int64_t>(r->size()));
+    throw skai::exception{
+        fmt::format("'len' expected string, array, dict, range or pipeline got '{}' instead", arg.type_to_string())};
+}
+SK_FUNC_END
+
+SK_FUNC(contains, 2, 2, false, args) {
+    auto map = args.at(0).template as<object::dict>();
+    if (!map) throw skai::exception{"'contains' expected dict as a first argument"};
+    return object::value::boolean(map->find(args.at(1)) != nullptr);
+}
+SK_FUNC_END
+
+// returns whether the key was there
+SK_FUNC(remove, 2, 2, false, args) {
+    auto map = args.at(0).template as<object::dict>();
+    if (!map) throw skai::exception{"'remove' expected dict as a first argument"};
+    return object::value::boolean(map->remove(args.at(1)));
 }
 SK_FUNC_END
 }  // namespace builtins
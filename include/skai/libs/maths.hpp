@@ -12,11 +12,10 @@
 #include <vector>
 namespace skai {
 namespace builtins {
-SK_FUNC(abs, 1, 1, false) {
-    if (auto inner = dynamic_cast<object::integer*>(args.at(0).get()))
-        return std::make_shared<object::integer>(std::abs(inner->value));
-    if (auto inner = dynamic_cast<object::ldouble*>(args.at(0).get()))
-        return std::make_shared<object::ldouble>(std::abs(inner->value));
+SK_FUNC(abs, 1, 1, false, args) {
+    const auto& inner = args.at(0);
+    if (inner.is_int()) return object::value::integer(std::abs(inner.as_int()));
+    if (inner.is_float()) return object::value::floating(std::abs(inner.as_float()));
     throw skai::exception{"'abs' expected arguments of type int/float"};
 }
 SK_FUNC_END
@@ -2,97 +2,755 @@
 #define SKAI_OBJECT_HPP_473893KEIEOE
 #include <fmt/format.h>
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
 #include <cstdint>
+#include <cstring>
+#include <limits>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "ast.hpp"
-#include "scope.hpp"
+#include "simd.hpp"
 
 namespace skai {
 namespace object {
+struct value;
+
+// heap object counters, reported by '--stats'
+struct heap_stats {
+    std::size_t allocated = 0;
+    std::size_t alive = 0;
+};
+inline heap_stats heap{};
+
+// free lists of fixed size blocks for heap objects, one per size class (multiples of 16 bytes up to 'max_size').
+// blocks are carved out of 'slab_size' slabs on demand and go back to their list once the object is freed, slabs are
+// never returned to the system. bigger objects go to the global allocator
+struct slab_allocator {
+    static constexpr std::size_t granularity = 16;
+    static constexpr std::size_t max_size = 256;
+    static constexpr std::size_t slab_size = 64 * 1024;
+
+    std::size_t pooled = 0;
+    std::size_t malloced = 0;
+    std::size_t slabs = 0;
+
+    void* allocate(std::size_t size) {
+        if (size > max_size) {
+            ++malloced;
+            return ::operator new(size);
+        }
+        ++pooled;
+        auto& cls = m_classes[(size - 1) / granularity];
+        if (auto block = cls.free) {
+            cls.free = block->next;
+            return block;
+        }
+        auto block_size = (size - 1) / granularity * granularity + granularity;
+        if (cls.left < block_size) m_refill(cls);
+        auto block = cls.cursor;
+        cls.cursor += block_size;
+        cls.left -= block_size;
+        return block;
+    }
+    void deallocate(void* ptr, std::size_t size) noexcept {
+        if (size > max_size) return ::operator delete(ptr);
+        auto& cls = m_classes[(size - 1) / granularity];
+        auto block = static_cast<free_block*>(ptr);
+        block->next = cls.free;
+        cls.free = block;
+    }
+
+   private:
+    struct free_block {
+        free_block* next;
+    };
+    struct size_class {
+        free_block* free = nullptr;
+        char* cursor = nullptr;
+        std::size_t left = 0;
+    };
+
+    // the first 16 bytes of a slab link it to the previous one, slabs stay reachable until the process exits
+    void m_refill(size_class& cls) {
+        auto slab = static_cast<char*>(::operator new(slab_size));
+        *reinterpret_cast<char**>(slab) = m_slabs;
+        m_slabs = slab;
+        ++slabs;
+        cls.cursor = slab + granularity;
+        cls.left = slab_size - granularity;
+    }
+
+    size_class m_classes[max_size / granularity] = {};
+    char* m_slabs = nullptr;
+};
+inline slab_allocator pools{};
+
+// dense type ids indexing the operator tables, the immediates come first in the order of value::kind. heap objects
+// store theirs so that dispatching needs neither a virtual call nor a cast
+enum class type_id : std::uint8_t { undefined, null, boolean, integer, floating, string, array, dict, other, count };
+
+// the backend running the script, lets native code call back into script functions. methods get it along with their
+// arguments so that 'map', 'filter'... can call the function they're given
+struct invoker {
+    virtual value invoke(const value& fn, const value* args, std::size_t argc) = 0;
+
+   protected:
+    ~invoker() = default;
+};
+
+// heap allocated runtime objects (strings, arrays, functions...), immediates like integers and booleans never get
+// here, they are stored inline in 'value'. objects are reference counted intrusively, the interpreter is single
+// threaded so the count isn't atomic
 struct object {
+    explicit object(type_id id = type_id::other) : m_type{id} {
+        ++heap.allocated;
+        ++heap.alive;
+    }
+    // a copy is a new object with its own count
+    object(const object& other) : object{other.m_type} {}
+    object& operator=(const object&) {
+        return *this;
+    }
     virtual std::string to_string() const = 0;
     virtual std::string type_to_string() const = 0;
-#define DEF_OPER(oper)                                                                                \
-    virtual std::shared_ptr<object> operator oper(const std::shared_ptr<object>& o) {                 \
-        throw skai::exception{fmt::format("invalid operand for token '{}', between {} and {}", #oper, \
-                                          type_to_string(), o->type_to_string())};                    \
-    }
-
-    DEF_OPER(+)
-    DEF_OPER(-)
-    DEF_OPER(+=)
-    DEF_OPER(-=)
-    DEF_OPER(*)
-    DEF_OPER(/)
-    DEF_OPER(*=)
-    DEF_OPER(/=)
-    DEF_OPER(&)
-    DEF_OPER(^)
-    DEF_OPER(|)
-    DEF_OPER(&=)
-    DEF_OPER(^=)
-    DEF_OPER(%)
-    DEF_OPER(%=)
-    DEF_OPER(|=)
-    DEF_OPER(>>)
-    DEF_OPER(<<)
-    DEF_OPER(>>=)
-    DEF_OPER(<<=)
-    DEF_OPER(==)
-    DEF_OPER(!=)
-    DEF_OPER(&&)
-    DEF_OPER(||)
-    DEF_OPER(<)
-    DEF_OPER(>)
-    DEF_OPER(<=)
-    DEF_OPER(>=)
-    DEF_OPER([])
-    virtual ~object() {}
+    virtual value binary(token op, const value& rhs);
+    virtual value subscript(const value& idx);
+    // 'target[idx] = val'
+    virtual void set_subscript(const value& idx, const value& val);
+    // 'target[begin:end]', an omitted bound is null
+    virtual value slice(const value& begin, const value& end);
+    // 'target.name(args...)'
+    virtual value method(std::string_view name, const value* args, std::size_t argc, invoker& inv);
+    // one step of 'for x of target': writes the element at 'cursor' to 'out' and moves the cursor past it, returns
+    // false once there are no more. a loop starts with the cursor at 0, what it counts is up to the object
+    virtual bool next(std::int64_t& cursor, value& out);
+    virtual ~object() {
+        --heap.alive;
+    }
+    // the destructor is virtual so 'delete' hands back the size of the most derived type, which picks the free list
+    static void* operator new(std::size_t size) {
+        return pools.allocate(size);
+    }
+    static void operator delete(void* ptr, std::size_t size) noexcept {
+        pools.deallocate(ptr, size);
+    }
+
+    void retain() {
+        ++m_refs;
+    }
+    void release() {
+        if (--m_refs == 0) delete this;
+    }
+    std::uint32_t refs() const {
+        return m_refs;
+    }
+    type_id type() const {
+        return m_type;
+    }
+    // whether it derives from 'container'
+    bool tracked() const {
+        return m_tracked;
+    }
+
+   protected:
+    bool m_tracked = false;
+
+   private:
+    std::uint32_t m_refs = 0;
+    const type_id m_type;
 };
-using arg_t = std::vector<std::shared_ptr<object>>;
-struct null : object {
-    std::string to_string() const override {
-        return "null";
+
+// 16 bytes tagged value, 'undefined' is internal and marks unbound slots (missing arguments, globals that are
+// referenced before their definition)
+struct value {
+    enum class kind : std::uint8_t { undefined, null, boolean, integer, floating, object };
+
+    value() noexcept : m_kind{kind::null}, m_int{0} {}
+    value(object* obj) noexcept : m_kind{obj ? kind::object : kind::null}, m_obj{obj} {
+        if (obj) obj->retain();
     }
-    std::string type_to_string() const override {
-        return "null";
+    value(const value& other) noexcept : m_kind{other.m_kind}, m_int{other.m_int} {
+        if (m_kind == kind::object) m_obj->retain();
+    }
+    value(value&& other) noexcept : m_kind{other.m_kind}, m_int{other.m_int} {
+        other.m_kind = kind::null;
     }
+    value& operator=(const value& other) noexcept {
+        if (other.m_kind == kind::object) other.m_obj->retain();
+        m_drop();
+        m_kind = other.m_kind;
+        m_int = other.m_int;
+        return *this;
+    }
+    value& operator=(value&& other) noexcept {
+        if (this != &other) {
+            m_drop();
+            m_kind = other.m_kind;
+            m_int = other.m_int;
+            other.m_kind = kind::null;
+        }
+        return *this;
+    }
+    ~value() {
+        m_drop();
+    }
+
+    static value undefined() {
+        value v;
+        v.m_kind = kind::undefined;
+        return v;
+    }
+    static value boolean(bool b) {
+        value v;
+        v.m_kind = kind::boolean;
+        v.m_bool = b;
+        return v;
+    }
+    static value integer(std::int64_t i) {
+        value v;
+        v.m_kind = kind::integer;
+        v.m_int = i;
+        return v;
+    }
+    static value floating(double d) {
+        value v;
+        v.m_kind = kind::floating;
+        v.m_float = d;
+        return v;
+    }
+
+    kind type() const {
+        return m_kind;
+    }
+    type_id id() const {
+        return m_kind == kind::object ? m_obj->type() : static_cast<type_id>(m_kind);
+    }
+    bool is_undefined() const {
+        return m_kind == kind::undefined;
+    }
+    bool is_null() const {
+        return m_kind == kind::null;
+    }
+    bool is_bool() const {
+        return m_kind == kind::boolean;
+    }
+    bool is_int() const {
+        return m_kind == kind::integer;
+    }
+    bool is_float() const {
+        return m_kind == kind::floating;
+    }
+    bool is_object() const {
+        return m_kind == kind::object;
+    }
+
+    bool as_bool() const {
+        return m_bool;
+    }
+    std::int64_t as_int() const {
+        return m_int;
+    }
+    double as_float() const {
+        return m_float;
+    }
+    object* as_object() const {
+        return m_obj;
+    }
+    template <class T>
+    T* as() const {
+        return m_kind == kind::object ? dynamic_cast<T*>(m_obj) : nullptr;
+    }
+
+    std::string to_string() const {
+        switch (m_kind) {
+            case kind::undefined:
+                return "undefined";
+            case kind::null:
+                return "null";
+            case kind::boolean:
+                return fmt::format("{}", m_bool);
+            case kind::integer:
+                return fmt::format("{}", m_int);
+            case kind::floating: {
+                std::ostringstream ss;
+                ss << m_float;
+                return ss.str();
+            }
+            case kind::object:
+                return m_obj->to_string();
+        }
+        return "";
+    }
+    std::string type_to_string() const {
+        switch (m_kind) {
+            case kind::undefined:
+                return "undefined";
+            case kind::null:
+                return "null";
+            case kind::boolean:
+                return "boolean";
+            case kind::integer:
+                return "integer";
+            case kind::floating:
+                return "float";  // kekw
+            case kind::object:
+                return m_obj->type_to_string();
+        }
+        return "";
+    }
+
+   private:
+    void m_drop() {
+        if (m_kind == kind::object) m_obj->release();
+    }
+
+    kind m_kind;
+    union {
+        bool m_bool;
+        std::int64_t m_int;
+        double m_float;
+        object* m_obj;
+    };
+};
+static_assert(sizeof(value) == 16, "values are expected to fit in two words");
+
+// owning pointer to a heap object of a known type
+template <class T>
+struct ref {
+    ref() = default;
+    ref(T* p) : m_ptr{p} {
+        if (m_ptr) m_ptr->retain();
+    }
+    ref(const ref& other) : ref(other.m_ptr) {}
+    ref(ref&& other) noexcept : m_ptr{std::exchange(other.m_ptr, nullptr)} {}
+    ref& operator=(ref other) noexcept {
+        std::swap(m_ptr, other.m_ptr);
+        return *this;
+    }
+    ~ref() {
+        if (m_ptr) m_ptr->release();
+    }
+
+    T* get() const {
+        return m_ptr;
+    }
+    T* operator->() const {
+        return m_ptr;
+    }
+    T& operator*() const {
+        return *m_ptr;
+    }
+    explicit operator bool() const {
+        return m_ptr != nullptr;
+    }
+    operator value() const {
+        return value{m_ptr};
+    }
+
+   private:
+    T* m_ptr = nullptr;
 };
+
+// reference counting alone never frees a cycle: a closure stored in a variable it captures, an array holding itself...
+// objects that can reference other objects derive from 'container' and are tracked by the cycle collector, which
+// finds the containers that are only referenced by each other and breaks them up
+struct tracer {
+    virtual void visit(object* child) = 0;
+
+    void operator()(const value& v) {
+        if (v.is_object()) visit(v.as_object());
+    }
+    template <class T>
+    void operator()(const ref<T>& r) {
+        if (r) visit(r.get());
+    }
+
+   protected:
+    ~tracer() = default;
+};
+
+struct container : object {
+    explicit container(type_id id = type_id::other);
+    container(const container& other) : container{other.type()} {}
+    ~container() override;
+
+    // visits every reference the object holds
+    virtual void trace(tracer&) {}
+    // drops them, the object is released right after. the collector breaks up cycles of garbage this way
+    virtual void clear() {}
+
+   private:
+    friend struct cycle_collector;
+    container* m_prev = nullptr;
+    container* m_next = nullptr;
+    // references from outside of the generation being collected
+    std::int32_t m_gc_refs = 0;
+    std::uint8_t m_generation = 0;
+    bool m_reached = false;
+};
+
+// trial deletion over two generations: for every container in a generation, the references held by other members are
+// subtracted from its count. what is left are references from outside (the stack, globals, native code, the other
+// generation), the containers that still have some are alive and so is everything they reach. the rest is garbage.
+// new containers are young, the young generation is collected every 'threshold' allocations and its survivors are
+// moved to the old generation, which is collected with it every 'full_every' young collections once it grew by a
+// quarter since its last collection
+struct cycle_collector {
+    enum generation : std::uint8_t { young, old };
+
+    // young containers allocated between two collections, 0 stops the automatic ones
+    std::size_t threshold = 700;
+    std::size_t full_every = 10;
+
+    std::size_t collections = 0;
+    std::size_t full_collections = 0;
+    std::size_t freed = 0;
+    std::chrono::nanoseconds total_pause{};
+    std::chrono::nanoseconds max_pause{};
+
+    void track(container* c) {
+        c->m_generation = young;
+        m_link(c);
+    }
+    void untrack(container* c) {
+        auto& head = m_heads[c->m_generation];
+        if (c->m_prev) c->m_prev->m_next = c->m_next;
+        if (c->m_next) c->m_next->m_prev = c->m_prev;
+        if (head == c) head = c->m_next;
+        --m_sizes[c->m_generation];
+    }
+    // called once a new container is referenced, a container's constructor must not create containers
+    void allocated() {
+        if (threshold == 0 || ++m_allocated < threshold || m_collecting) return;
+        bool full = ++m_young_runs >= full_every && m_promoted * 4 > m_sizes[old];
+        collect(full);
+    }
+
+    // returns the number of containers freed
+    std::size_t collect(bool full) {
+        if (m_collecting) return 0;
+        m_collecting = true;
+        auto start = std::chrono::steady_clock::now();
+        if (full) {
+            while (auto c = m_heads[young]) {
+                untrack(c);
+                c->m_generation = old;
+                m_link(c);
+            }
+        }
+        auto gen = full ? old : young;
+        auto garbage = m_garbage(gen);
+        // kept alive while the cycles are broken so that none of them is freed before all are cleared
+        for (auto c : garbage) c->retain();
+        for (auto c : garbage) c->clear();
+        for (auto c : garbage) c->release();
+        if (!full) {
+            while (auto c = m_heads[young]) {
+                untrack(c);
+                c->m_generation = old;
+                m_link(c);
+                ++m_promoted;
+            }
+        } else {
+            m_promoted = 0;
+            m_young_runs = 0;
+            ++full_collections;
+        }
+        m_allocated = 0;
+        m_collecting = false;
+
+        auto pause = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        ++collections;
+        freed += garbage.size();
+        total_pause += pause;
+        max_pause = std::max(max_pause, pause);
+        return garbage.size();
+    }
+
+   private:
+    void m_link(container* c) {
+        auto& head = m_heads[c->m_generation];
+        c->m_prev = nullptr;
+        c->m_next = head;
+        if (head) head->m_prev = c;
+        head = c;
+        ++m_sizes[c->m_generation];
+    }
+
+    std::vector<container*> m_garbage(generation gen) {
+        struct subtract : tracer {
+            generation gen;
+            subtract(generation g) : gen{g} {}
+            void visit(object* child) override {
+                if (!child->tracked()) return;
+                auto c = static_cast<container*>(child);
+                if (c->m_generation == gen) --c->m_gc_refs;
+            }
+        } sub{gen};
+        for (auto c = m_heads[gen]; c; c = c->m_next) {
+            c->m_gc_refs = static_cast<std::int32_t>(c->refs());
+            c->m_reached = false;
+        }
+        for (auto c = m_heads[gen]; c; c = c->m_next) c->trace(sub);
+
+        struct mark : tracer {
+            generation gen;
+            std::vector<container*> pending;
+            mark(generation g) : gen{g} {}
+            void visit(object* child) override {
+                if (!child->tracked()) return;
+                auto c = static_cast<container*>(child);
+                if (c->m_generation != gen || c->m_reached) return;
+                c->m_reached = true;
+                pending.push_back(c);
+            }
+        } reach{gen};
+        for (auto c = m_heads[gen]; c; c = c->m_next)
+            if (c->m_gc_refs > 0) reach.visit(c);
+        while (!reach.pending.empty()) {
+            auto c = reach.pending.back();
+            reach.pending.pop_back();
+            c->trace(reach);
+        }
+
+        std::vector<container*> garbage;
+        for (auto c = m_heads[gen]; c; c = c->m_next)
+            if (!c->m_reached) garbage.push_back(c);
+        return garbage;
+    }
+
+    container* m_heads[2] = {};
+    std::size_t m_sizes[2] = {};
+    std::size_t m_allocated = 0;
+    std::size_t m_young_runs = 0;
+    // survivors of young collections since the last full one
+    std::size_t m_promoted = 0;
+    bool m_collecting = false;
+};
+inline cycle_collector cycles{};
+
+inline container::container(type_id id) : object{id} {
+    m_tracked = true;
+    cycles.track(this);
+}
+inline container::~container() {
+    cycles.untrack(this);
+}
+
+template <class T, class... Args>
+ref<T> make(Args&&... args) {
+    ref<T> out{new T(std::forward<Args>(args)...)};
+    if constexpr (std::is_base_of_v<container, T>) cycles.allocated();
+    return out;
+}
+
+[[noreturn]] inline void invalid_operands(token op, const value& lhs, const value& rhs) {
+    throw skai::exception{fmt::format("invalid operand for binary operator '{}', '{}' and '{}'", token_str(op),
+                                      lhs.type_to_string(), rhs.type_to_string())};
+}
+
+inline value object::binary(token op, const value& rhs) {
+    throw skai::exception{
+        fmt::format("invalid operand for token '{}', between {} and {}", token_str(op), type_to_string(),
+                    rhs.type_to_string())};
+}
+inline value object::subscript(const value&) {
+    throw skai::exception{fmt::format("'{}' is not subscriptable", type_to_string())};
+}
+inline void object::set_subscript(const value&, const value&) {
+    throw skai::exception{fmt::format("'{}' does not support item assignment", type_to_string())};
+}
+inline value object::slice(const value&, const value&) {
+    throw skai::exception{fmt::format("'{}' can't be sliced", type_to_string())};
+}
+inline value object::method(std::string_view name, const value*, std::size_t, invoker&) {
+    throw skai::exception{fmt::format("'{}' has no method '{}'", type_to_string(), name)};
+}
+
+inline bool object::next(std::int64_t&, value&) {
+    throw skai::exception{fmt::format("'{}' is not iterable", type_to_string())};
+}
+
+inline value call_method(const value& target, std::string_view name, const value* args, std::size_t argc,
+                         invoker& inv) {
+    if (!target.is_object())
+        throw skai::exception{fmt::format("'{}' has no method '{}'", target.type_to_string(), name)};
+    return target.as_object()->method(name, args, argc, inv);
+}
+inline bool next(const value& target, std::int64_t& cursor, value& out) {
+    if (!target.is_object()) throw skai::exception{fmt::format("'{}' is not iterable", target.type_to_string())};
+    return target.as_object()->next(cursor, out);
+}
+
+// int64 arithmetic that reports overflows instead of wrapping around
+inline std::int64_t checked(token op, std::int64_t l, std::int64_t r) {
+    std::int64_t out{};
+    bool overflow{};
+#if defined(__GNUC__) || defined(__clang__)
+    if (op == token::plus)
+        overflow = __builtin_add_overflow(l, r, &out);
+    else if (op == token::minus)
+        overflow = __builtin_sub_overflow(l, r, &out);
+    else
+        overflow = __builtin_mul_overflow(l, r, &out);
+#else
+    constexpr auto max = std::numeric_limits<std::int64_t>::max();
+    constexpr auto min = std::numeric_limits<std::int64_t>::min();
+    if (op == token::plus) {
+        overflow = (r > 0 && l > max - r) || (r < 0 && l < min - r);
+        out = overflow ? 0 : l + r;
+    } else if (op == token::minus) {
+        overflow = (r < 0 && l > max + r) || (r > 0 && l < min + r);
+        out = overflow ? 0 : l - r;
+    } else {
+        overflow = l != 0 && r != 0 &&
+                   ((l == -1 && r == min) || (r == -1 && l == min) || (l != -1 && r != -1 && (l * r) / r != l));
+        out = overflow ? 0 : l * r;
+    }
+#endif
+    if (overflow) throw skai::exception{"integer overflow"};
+    return out;
+}
+// '<<' and '>>', the bits shifted out of a left shift are dropped like they are for unsigned integers
+inline std::int64_t shifted(token op, std::int64_t l, std::int64_t r) {
+    if (r < 0 || r >= 64) throw skai::exception{fmt::format("shift count {} is out of range 0 to 63", r)};
+    if (op == token::rshift) return l >> r;
+    return static_cast<std::int64_t>(static_cast<std::uint64_t>(l) << r);
+}
+
+inline value int_binary(token op, std::int64_t l, std::int64_t r) {
+    switch (op) {
+        case token::plus:
+        case token::minus:
+        case token::star:
+            return value::integer(checked(op, l, r));
+        case token::slash:
+            return value::floating(static_cast<double>(l) / static_cast<double>(r));
+        case token::mod:
+            if (r == 0) throw skai::exception{"integer modulo by zero"};
+            return value::integer(r == -1 ? 0 : l % r);
+        case token::b_and:
+            return value::integer(l & r);
+        case token::b_or:
+            return value::integer(l | r);
+        case token::xor_:
+            return value::integer(l ^ r);
+        case token::lshift:
+        case token::rshift:
+            return value::integer(shifted(op, l, r));
+        case token::d_eq:
+            return value::boolean(l == r);
+        case token::not_eq_:
+            return value::boolean(l != r);
+        case token::lt:
+            return value::boolean(l < r);
+        case token::lt_eq:
+            return value::boolean(l <= r);
+        case token::gt:
+            return value::boolean(l > r);
+        case token::gt_eq:
+            return value::boolean(l >= r);
+    }
+    invalid_operands(op, value::integer(l), value::integer(r));
+}
+
+inline value float_binary(token op, double l, double r) {
+    switch (op) {
+        case token::plus:
+            return value::floating(l + r);
+        case token::minus:
+            return value::floating(l - r);
+        case token::star:
+            return value::floating(l * r);
+        case token::slash:
+            return value::floating(l / r);
+        case token::mod:
+            return value::floating(std::fmod(l, r));
+        case token::d_eq:
+            return value::boolean(l == r);
+        case token::not_eq_:
+            return value::boolean(l != r);
+        case token::lt:
+            return value::boolean(l < r);
+        case token::lt_eq:
+            return value::boolean(l <= r);
+        case token::gt:
+            return value::boolean(l > r);
+        case token::gt_eq:
+            return value::boolean(l >= r);
+    }
+    invalid_operands(op, value::floating(l), value::floating(r));
+}
+
+// prefix '-', '+' and '!'
+inline value unary(token op, const value& target) {
+    switch (op) {
+        case token::minus:
+            if (target.is_int()) return value::integer(checked(token::minus, 0, target.as_int()));
+            if (target.is_float()) return value::floating(-target.as_float());
+            break;
+        case token::plus:
+            if (target.is_int() || target.is_float()) return target;
+            break;
+        case token::not_:
+            if (target.is_bool()) return value::boolean(!target.as_bool());
+            break;
+    }
+    throw skai::exception{fmt::format("invalid operand for token '{}'", token_str(op))};
+}
+
+using arg_t = std::vector<value>;
 template <class InterpreterClass>
-struct callable : object {
+struct callable : container {
     /*
      */
     virtual std::size_t mina() = 0;
     virtual std::size_t maxa() = 0;
     virtual bool variadic() const = 0;
-    virtual std::shared_ptr<object> call(InterpreterClass&, const std::vector<std::shared_ptr<object>>& args) = 0;
+    virtual value call(InterpreterClass&, const std::vector<value>& args) = 0;
     virtual ~callable() {}
 };
 
-#define SK_FUNC(name, arg1, arg2, var, args)                          \
-    template <class InterpreterClass>                                 \
-    struct name : object::callable<InterpreterClass> {                \
-        std::size_t mina() override {                                 \
-            return arg1;                                              \
-        }                                                             \
-        std::size_t maxa() override {                                 \
-            return arg2;                                              \
-        }                                                             \
-        bool variadic() const override {                              \
-            return var;                                               \
-        }                                                             \
-        std::string to_string() const override {                      \
-            return "[pure function]";                                 \
-        }                                                             \
-        std::string type_to_string() const override {                 \
-            return "function";                                        \
-        }                                                             \
-        std::shared_ptr<object::object> call(InterpreterClass&, \
-                                             const std::vector<std::shared_ptr<object::object>>& args) override
+inline void check_arity(std::size_t argc, std::size_t min, std::size_t max) {
+    if (argc >= min && argc <= max) return;
+    std::string pref = argc > max   ? fmt::format("at most '{}' argument", max)
+                       : argc < min ? fmt::format("at least '{}' argument", min)
+                                    : fmt::format("'{}' argument", max);
+    throw skai::exception{fmt::format("unmatched arguments count, expected {}, got {} instead", pref, argc)};
+}
+template <class InterpreterClass>
+void check_arity(callable<InterpreterClass>& fn, std::size_t argc) {
+    if (!fn.variadic()) check_arity(argc, fn.mina(), fn.maxa());
+}
+
+#define SK_FUNC(name, arg1, arg2, var, args)                                                  \
+    template <class InterpreterClass>                                                         \
+    struct name : object::callable<InterpreterClass> {                                        \
+        std::size_t mina() override {                                                         \
+            return arg1;                                                                      \
+        }                                                                                     \
+        std::size_t maxa() override {                                                         \
+            return arg2;                                                                      \
+        }                                                                                     \
+        bool variadic() const override {                                                      \
+            return var;                                                                       \
+        }                                                                                     \
+        std::string to_string() const override {                                              \
+            return "[pure function]";                                                         \
+        }                                                                                     \
+        std::string type_to_string() const override {                                        \
+            return "function";                                                                \
+        }                                                                                     \
+        object::value call(InterpreterClass&, const std::vector<object::value>& args) override
 
 // clang-format off
 #define SK_FUNC_END };
@@ -100,295 +758,1152 @@ struct callable : object {
 
 template <class InterpreterClass>
 struct module_base : object {
-    virtual std::vector<std::shared_ptr<object>> objects() = 0;
+    virtual std::vector<value> objects() = 0;
     virtual ~module_base() {}
 };
+// a local captured by a nested function, shared between its frame and every closure referencing it
+struct cell : container {
+    struct value value;
+
+    cell(const struct value& v) : value{v} {}
+
+    void trace(tracer& t) override {
+        t(value);
+    }
+    void clear() override {
+        value = {};
+    }
+
+    std::string to_string() const override {
+        return value.to_string();
+    }
+    std::string type_to_string() const override {
+        return value.type_to_string();
+    }
+};
+
 template <class InterpreterClass>
 struct function : callable<InterpreterClass> {
-    function(function_stmt fnc, const scope<object>& s, bool init = false, bool v = false)
-        : decl{fnc}, env{s.get_contents()}, variadic_{v}, is_init{init} {}
+    function(const ast* t, node_ref fnc, std::vector<ref<cell>> u, bool v = false)
+        : tree{t}, decl{fnc}, upvalues{std::move(u)}, variadic_{v} {}
 
     std::string to_string() const override {
-        return fmt::format("[function '{}']", decl.name);
+        return fmt::format("[function '{}']", tree->str(m_decl().name));
     }
 
     std::string type_to_string() const override {
         return "function";
     }
     std::size_t mina() override {
-        return std::count_if(decl.arguments.begin(), decl.arguments.end(),
-                             [](const auto& s) { return s->def == nullptr; });
+        auto args = tree->nodes(m_decl().arguments);
+        return std::count_if(args.begin(), args.end(),
+                             [this](node_ref arg) { return tree->get<argument_expr>(arg).def == 0; });
     }
 
     std::size_t maxa() override {
-        return decl.arguments.size();
+        return m_decl().arguments.size;
     }
 
-    std::shared_ptr<object> call(InterpreterClass& inter, const std::vector<std::shared_ptr<object>>& args) override {
-        for (std::size_t i = 0; i < maxa(); ++i) {
-            try {
-                env.define(decl.arguments.at(i)->name, args.at(i));
-            } catch (std::out_of_range&) {
-                env.define(decl.arguments.at(i)->name, inter.m_eval(decl.arguments.at(i)->def));
-            }
-        }
-
-        inter.set_in_func(true);
-        inter.m_exec_block(decl.body, env, true);
-        inter.set_in_func(false);
-        auto ret = inter.get_return();
-        if (!dynamic_cast<null*>(ret.get()) && is_init)
-            throw skai::exception{"constructors can't return anything"};
-
-        inter.set_ret(std::make_shared<null>());
-        if (is_init) return env.get("self");
-        return ret;
+    value call(InterpreterClass& inter, const std::vector<value>& args) override {
+        return inter.m_call(m_decl(), upvalues, args);
     }
 
-    template <class Instance>
-    auto bind(Instance* ins) {
-        auto e{env};
-        e.define("self", ins);
-        return std::make_shared<function<InterpreterClass>>(decl, e, is_init);
+    void trace(tracer& t) override {
+        for (const auto& up : upvalues) t(up);
+    }
+    void clear() override {
+        upvalues.clear();
     }
 
     bool variadic() const override {
         return variadic_;
     }
 
-    function_stmt decl;
-    scope<object> env;
+    // the ast outlives every function created from it
+    const ast* tree;
+    node_ref decl;
+    std::vector<ref<cell>> upvalues;
     bool variadic_;
-    bool is_init;
+
+   private:
+    const function_stmt& m_decl() const {
+        return tree->get<function_stmt>(decl);
+    }
 };
 
-#define ADD_OP(ret, op, arg)                                                                              \
-    std::shared_ptr<object> operator op(const std::shared_ptr<object>& obj) override {                    \
-        if (auto v = dynamic_cast<arg*>(obj.get())) { return std::make_shared<ret>(value op v->value); }  \
-        throw skai::exception{fmt::format("invalid operand for binary operator '{}', '{}' and '{}'", #op, \
-                                          type_to_string(), obj->type_to_string())};                      \
+inline struct value character(char c);
+inline struct value intern(std::string_view text);
+// a string owns its text, or points into the buffer of the string that owns it (a slice) and keeps that one alive.
+// once the owner is only referenced by its slices and is much larger than a slice, the slice copies its text out the
+// next time it's used so that the owner can go
+struct string : object {
+    // slices this short are copied, the text fits in the object like the slice bookkeeping would
+    static constexpr std::size_t inline_size = 15;
+    // a slice leaves an orphaned owner that is this many times larger
+    static constexpr std::size_t detach_ratio = 4;
+
+    string(std::string v) : object{type_id::string}, m_value{std::move(v)} {}
+    string(const ref<string>& owner, std::size_t begin, std::size_t size)
+        : object{type_id::string}, m_owner{owner}, m_begin{begin}, m_size{size} {
+        ++owner->m_slices;
+    }
+    ~string() override {
+        if (m_owner) --m_owner->m_slices;
+    }
+
+    std::string_view view() const {
+        if (!m_owner) return m_value;
+        if (m_owner->refs() == m_owner->m_slices && m_owner->m_value.size() / detach_ratio > m_size) {
+            m_value.assign(m_owner->m_value, m_begin, m_size);
+            --m_owner->m_slices;
+            m_owner = ref<string>{};
+            return m_value;
+        }
+        return std::string_view{m_owner->m_value}.substr(m_begin, m_size);
+    }
+    // only a string that owns its text can grow, the caller makes sure nothing else references it
+    bool append(std::string_view text) {
+        if (m_owner) return false;
+        m_value.append(text);
+        m_hash = 0;
+        return true;
+    }
+
+    // computed on first use and kept, 0 stands for not computed yet
+    std::size_t hash() const {
+        if (m_hash == 0) m_hash = std::hash<std::string_view>{}(view()) | 1;
+        return m_hash;
     }
-#define BIND_OP(ret, cxxfn, arg, op)                                                                               \
-    std::shared_ptr<object> operator op(const std::shared_ptr<object>& obj) override {                             \
-        if (auto v = dynamic_cast<arg*>(obj.get())) { return std::make_shared<ret>(std::cxxfn(value, v->value)); } \
-        throw skai::exception{fmt::format("invalid operand for binary operator '{}', '{}' and '{}'", #op,          \
-                                          type_to_string(), obj->type_to_string())};                               \
+    bool interned() const {
+        return m_interned;
+    }
+    // the text of two interned strings is only the same if they are the same string, known hashes rule out most other
+    // mismatches before the bytes are compared
+    static bool equal(const string& lhs, const string& rhs) {
+        if (&lhs == &rhs) return true;
+        if (lhs.m_interned && rhs.m_interned) return false;
+        if (lhs.m_hash != 0 && rhs.m_hash != 0 && lhs.m_hash != rhs.m_hash) return false;
+        return lhs.view() == rhs.view();
     }
-struct boolean : object {
-    bool value;
-    boolean(bool v) : value{v} {}
 
     std::string to_string() const override {
-        return fmt::format("{}", value);
+        return std::string{view()};
     }
     std::string type_to_string() const override {
-        return "boolean";
+        return "string";
     }
-    ADD_OP(boolean, ==, boolean)
-    ADD_OP(boolean, !=, boolean)
-    ADD_OP(boolean, &&, boolean)
-    ADD_OP(boolean, ||, boolean)
+
+    struct value subscript(const struct value& idx) override {
+        if (!idx.is_int())
+            throw skai::exception{fmt::format("expected type integer in string subscript operator got '{}' instead",
+                                              idx.type_to_string())};
+        auto text = view();
+        auto at = idx.as_int() < 0 ? idx.as_int() + static_cast<std::int64_t>(text.size()) : idx.as_int();
+        if (at < 0 || at >= static_cast<std::int64_t>(text.size()))
+            throw skai::exception{fmt::format("out of bounds index '{}'", idx.as_int())};
+        return character(text[at]);
+    }
+    struct value slice(const struct value& begin, const struct value& end) override {
+        auto size = static_cast<std::int64_t>(view().size());
+        auto from = m_bound(begin, 0, "begin"), to = m_bound(end, size, "end");
+        if (from < 0) from += size;
+        if (to < 0) to += size;
+        if (from < 0 || to > size || from > to)
+            throw skai::exception{fmt::format("out of bounds slice [{}:{}] of a string of size {}", from, to, size)};
+        return m_slice(from, to);
+    }
+    struct value method(std::string_view name, const struct value* args, std::size_t argc, invoker& inv) override;
+    bool next(std::int64_t& cursor, struct value& out) override {
+        auto text = view();
+        if (cursor >= static_cast<std::int64_t>(text.size())) return false;
+        out = character(text[cursor++]);
+        return true;
+    }
+
+   private:
+    friend struct value character(char c);
+    friend struct value intern(std::string_view text);
+
+    static std::int64_t m_bound(const struct value& bound, std::int64_t omitted, const char* which) {
+        if (bound.is_null()) return omitted;
+        if (!bound.is_int())
+            throw skai::exception{
+                fmt::format("expected type integer as the {} of a slice got '{}' instead", which, bound.type_to_string())};
+        return bound.as_int();
+    }
+    // 'begin' and 'end' are within the text
+    struct value m_slice(std::size_t begin, std::size_t end) {
+        auto text = view();
+        if (end - begin == 1) return character(text[begin]);
+        if (end - begin == text.size()) return ref<string>{this};
+        if (end - begin <= inline_size) return make<string>(std::string{text.substr(begin, end - begin)});
+        // slices of a slice share the buffer of the same owner
+        if (m_owner) return make<string>(m_owner, m_begin + begin, end - begin);
+        return make<string>(ref<string>{this}, begin, end - begin);
+    }
+
+    mutable std::string m_value;
+    mutable ref<string> m_owner;
+    std::size_t m_begin = 0;
+    std::size_t m_size = 0;
+    // slices pointing into this string's buffer
+    std::uint32_t m_slices = 0;
+    mutable std::size_t m_hash = 0;
+    bool m_interned = false;
 };
-struct ldouble : object {
-    long double value;
-    ldouble(long double v) : value{v} {}
+// one character strings are shared, they are never modified in place
+inline struct value character(char c) {
+    static ref<string> cache[256];
+    auto& str = cache[static_cast<unsigned char>(c)];
+    if (!str) {
+        str = make<string>(std::string(1, c));
+        str->m_interned = true;
+        str->hash();
+    }
+    return str;
+}
+// the one string with this text, string literals and method names are interned so that equal texts are the same
+// object. the table holds a reference, an interned string is never appended to in place and its key stays valid
+inline struct value intern(std::string_view text) {
+    if (text.size() == 1) return character(text[0]);
+    static std::unordered_map<std::string_view, ref<string>> table;
+    if (auto it = table.find(text); it != table.end()) return it->second;
+    auto str = make<string>(std::string{text});
+    str->m_interned = true;
+    str->hash();
+    table.emplace(str->view(), str);
+    return str;
+}
+
+// arrays whose elements all have the same type (integers, floats or booleans) store them unboxed and contiguously, so
+// that the element-wise operators and the reductions run simd kernels over them. writing an element of another type
+// turns the array into a generic one for good
+struct array : container {
+    enum class kind : std::uint8_t { generic, integer, floating, boolean };
+
+    array(std::vector<value> v) : container{type_id::array} {
+        m_adopt(std::move(v));
+    }
+    array(std::vector<std::int64_t> v) : container{type_id::array}, m_kind{kind::integer}, m_ints{std::move(v)} {}
+    array(std::vector<double> v) : container{type_id::array}, m_kind{kind::floating}, m_floats{std::move(v)} {}
+    array(std::vector<std::uint8_t> v) : container{type_id::array}, m_kind{kind::boolean}, m_bools{std::move(v)} {}
+
+    kind elements() const {
+        return m_kind;
+    }
+    std::size_t size() const {
+        switch (m_kind) {
+            case kind::integer:
+                return m_ints.size();
+            case kind::floating:
+                return m_floats.size();
+            case kind::boolean:
+                return m_bools.size();
+        }
+        return m_values.size();
+    }
+    // 'i' is within the array
+    value at(std::size_t i) const {
+        switch (m_kind) {
+            case kind::integer:
+                return value::integer(m_ints[i]);
+            case kind::floating:
+                return value::floating(m_floats[i]);
+            case kind::boolean:
+                return value::boolean(m_bools[i]);
+        }
+        return m_values[i];
+    }
+    void set(std::size_t i, const value& val) {
+        if (m_kind == kind::integer && val.is_int()) {
+            m_ints[i] = val.as_int();
+        } else if (m_kind == kind::floating && val.is_float()) {
+            m_floats[i] = val.as_float();
+        } else if (m_kind == kind::boolean && val.is_bool()) {
+            m_bools[i] = val.as_bool();
+        } else {
+            if (m_kind != kind::generic) m_generalize();
+            m_values[i] = val;
+        }
+    }
+    // storage of a typed array, for the kernels
+    const std::int64_t* ints() const {
+        return m_ints.data();
+    }
+    const double* floats() const {
+        return m_floats.data();
+    }
 
     std::string to_string() const override {
-        std::ostringstream ss;
-        ss << value;
-        return ss.str();
+        std::string full{"["};
+        for (std::size_t i = 0; i < size(); ++i) {
+            full += at(i).to_string();
+            if (i != size() - 1) full += ',';
+        }
+        full += ']';
+        return full;
     }
     std::string type_to_string() const override {
-        return "float";  // kekw
-    }
-    ADD_OP(ldouble, +, ldouble)
-    ADD_OP(ldouble, -, ldouble)
-    ADD_OP(ldouble, /, ldouble)
-    ADD_OP(ldouble, *, ldouble)
-    BIND_OP(ldouble, fmod, ldouble, %)
-    ADD_OP(boolean, ==, ldouble)
-    ADD_OP(boolean, !=, ldouble)
-    ADD_OP(boolean, <, ldouble)
-    ADD_OP(boolean, >, ldouble)
-    ADD_OP(boolean, <=, ldouble)
-    ADD_OP(boolean, >=, ldouble)
-};
-struct integer : object {
-    std::int64_t value;
-    integer(std::int64_t v) : value{v} {}
+        return "array";
+    }
+    value subscript(const value& idx) override {
+        return at(m_index(idx));
+    }
+    void set_subscript(const value& idx, const value& val) override {
+        set(m_index(idx), val);
+    }
+    // 'sum()', 'min()', 'max()', 'dot(other)', 'map(fn)', 'filter(fn)', 'reduce(fn[, init])', 'each(fn)'
+    value method(std::string_view name, const value* args, std::size_t argc, invoker& inv) override;
+    bool next(std::int64_t& cursor, value& out) override {
+        if (cursor >= static_cast<std::int64_t>(size())) return false;
+        out = at(cursor++);
+        return true;
+    }
 
-    std::string to_string() const override {
-        return fmt::format("{}", value);
+    // typed arrays hold no references
+    void trace(tracer& t) override {
+        for (const auto& v : m_values) t(v);
+    }
+    void clear() override {
+        std::vector<value>{}.swap(m_values);
     }
 
-    std::string type_to_string() const override {
-        return "integer";
-    }
-    ADD_OP(integer, +, integer)
-    ADD_OP(integer, -, integer)
-    std::shared_ptr<object> operator /(const std::shared_ptr<object>& obj) override {
-        if (auto v = dynamic_cast<integer*>(obj.get())) { return std::make_shared<ldouble>(static_cast<long double>(value) / static_cast<long double>(v->value)); }
-        throw skai::exception{fmt::format("invalid operand for binary operator '{}', '{}' and '{}'", '/',
-                                          type_to_string(), obj->type_to_string())};
-    }
-    ADD_OP(integer, *, integer)
-    ADD_OP(integer, ^, integer)
-    ADD_OP(integer, |, integer)
-    ADD_OP(integer, &, integer)
-    ADD_OP(integer, %, integer)
-    ADD_OP(integer, >>, integer)
-    ADD_OP(integer, <<, integer)
-    ADD_OP(boolean, ==, integer)
-    ADD_OP(boolean, !=, integer)
-    ADD_OP(boolean, <, integer)
-    ADD_OP(boolean, >, integer)
-    ADD_OP(boolean, <=, integer)
-    ADD_OP(boolean, >=, integer)
+   private:
+    std::size_t m_index(const value& idx) const {
+        if (!idx.is_int())
+            throw skai::exception{fmt::format("expected type integer in array subscript operator got '{}' instead",
+                                              idx.type_to_string())};
+        auto at = idx.as_int() < 0 ? idx.as_int() + static_cast<std::int64_t>(size()) : idx.as_int();
+        if (at < 0 || at >= static_cast<std::int64_t>(size()))
+            throw skai::exception{fmt::format("out of bounds index '{}'", idx.as_int())};
+        return static_cast<std::size_t>(at);
+    }
+    void m_adopt(std::vector<value>&& v) {
+        auto id = v.empty() ? type_id::null : v[0].id();
+        bool same = std::all_of(v.begin(), v.end(), [id](const value& e) { return e.id() == id; });
+        if (!same || (id != type_id::integer && id != type_id::floating && id != type_id::boolean)) {
+            m_values = std::move(v);
+            return;
+        }
+        for (const auto& e : v) {
+            if (id == type_id::integer) m_ints.push_back(e.as_int());
+            if (id == type_id::floating) m_floats.push_back(e.as_float());
+            if (id == type_id::boolean) m_bools.push_back(e.as_bool());
+        }
+        m_kind = id == type_id::integer ? kind::integer : id == type_id::floating ? kind::floating : kind::boolean;
+    }
+    void m_generalize() {
+        m_values.reserve(size());
+        for (std::size_t i = 0; i < size(); ++i) m_values.push_back(at(i));
+        m_ints = {};
+        m_floats = {};
+        m_bools = {};
+        m_kind = kind::generic;
+    }
+
+    kind m_kind = kind::generic;
+    std::vector<value> m_values;
+    std::vector<std::int64_t> m_ints;
+    std::vector<double> m_floats;
+    std::vector<std::uint8_t> m_bools;
 };
-struct string : object {
-    std::string value;
-    string(std::string v) : value{v} {}
+
+// 'begin..end..step', the integers from begin up to end (excluded) by step. only the bounds are stored, the elements
+// are computed when they're read so a range of any length takes the same memory
+struct range : object {
+    range(const value& begin, const value& end, const value& step)
+        : m_begin{m_bound(begin, "begin")},
+          m_end{m_bound(end, "end")},
+          m_step{step.is_null() ? 1 : m_bound(step, "step")} {
+        if (m_step == 0) throw skai::exception{"range step can't be 0"};
+        // in unsigned arithmetic, the distance between two int64 may not fit in one
+        bool up = m_step > 0;
+        if (up ? m_end <= m_begin : m_end >= m_begin) return;
+        auto distance =
+            up ? std::uint64_t(m_end) - std::uint64_t(m_begin) : std::uint64_t(m_begin) - std::uint64_t(m_end);
+        auto stride = up ? std::uint64_t(m_step) : 0 - std::uint64_t(m_step);
+        m_size = (distance - 1) / stride + 1;
+        if (m_size > std::uint64_t(std::numeric_limits<std::int64_t>::max()))
+            throw skai::exception{fmt::format("range {} has too many elements", to_string())};
+    }
+
+    std::uint64_t size() const {
+        return m_size;
+    }
+    // 'i' is within the range
+    value at(std::uint64_t i) const {
+        return value::integer(static_cast<std::int64_t>(std::uint64_t(m_begin) + i * std::uint64_t(m_step)));
+    }
 
     std::string to_string() const override {
-        std::string str;
-        for (std::size_t i = 0; i < value.size(); ++i) {
-            if (value.at(i) == '\\') {
-                switch (char c = value.at(i + 1)) {
-                    default:
-                        throw skai::exception{fmt::format("invalid escape character '{}'", c)};
-                    case 'n':
-                        str.push_back('\n');
-                        break;
-                    case 't':
-                        str.push_back('\t');
-                        break;
-                    case 'r':
-                        str.push_back('\r');
-                        break;
-                    case '\\':
-                        str.push_back('\\');
-                        break;
-                    case '"':
-                        str.push_back('"');
-                        break;
-                    case 'b':
-                        str.push_back('\b');
-                        break;
-                    case 'v':
-                        str.push_back('\v');
-                        break;
-                    case 'f':
-                        str.push_back('\f');
-                        break;
-                    case '0':
-                        str.push_back('\0');
-                        break;
-                }
-                i += 2;
-            } else {
-                str.push_back(value.at(i));
-            }
-        }
-        return str;
+        if (m_step == 1) return fmt::format("{}..{}", m_begin, m_end);
+        return fmt::format("{}..{}..{}", m_begin, m_end, m_step);
     }
     std::string type_to_string() const override {
-        return "string";
+        return "range";
     }
-    ADD_OP(string, +, string)
-    ADD_OP(boolean, ==, string)
-    ADD_OP(boolean, !=, string)
-    ADD_OP(boolean, <, string)
-    ADD_OP(boolean, >, string)
-    ADD_OP(boolean, <=, string)
-    ADD_OP(boolean, >=, string)
-
-    std::shared_ptr<object> operator[](const std::shared_ptr<object>& idx) override {
-        if (auto i = dynamic_cast<integer*>(idx.get())) {
-            std::size_t start = 0;
-            if (i->value < 0) start = value.size();
-            try {
-                return std::make_shared<string>(std::string(1, value.at(start + i->value)));
-            } catch (std::out_of_range&) { throw skai::exception{fmt::format("out of bounds index '{}'", i->value)}; }
-        }
-        throw skai::exception{
-            fmt::format("expected type integer in string subscript operator got '{}' instead", idx->type_to_string())};
+    value subscript(const value& idx) override {
+        if (!idx.is_int())
+            throw skai::exception{fmt::format("expected type integer in range subscript operator got '{}' instead",
+                                              idx.type_to_string())};
+        auto at = idx.as_int() < 0 ? idx.as_int() + static_cast<std::int64_t>(m_size) : idx.as_int();
+        if (at < 0 || static_cast<std::uint64_t>(at) >= m_size)
+            throw skai::exception{fmt::format("out of bounds index '{}'", idx.as_int())};
+        return this->at(static_cast<std::uint64_t>(at));
     }
+    bool next(std::int64_t& cursor, value& out) override {
+        if (static_cast<std::uint64_t>(cursor) >= m_size) return false;
+        out = at(static_cast<std::uint64_t>(cursor++));
+        return true;
+    }
+
+   private:
+    static std::int64_t m_bound(const value& bound, const char* which) {
+        if (!bound.is_int())
+            throw skai::exception{
+                fmt::format("expected type integer as the {} of a range got '{}' instead", which, bound.type_to_string())};
+        return bound.as_int();
+    }
+
+    std::int64_t m_begin;
+    std::int64_t m_end;
+    std::int64_t m_step;
+    std::uint64_t m_size = 0;
 };
-struct array : object {
-    std::vector<std::shared_ptr<object>> values;
 
-    array(const std::vector<std::shared_ptr<object>>& v) : values{v} {}
+// a hash map that keeps its entries in insertion order. the entries are stored densely, the index on top of them is an
+// open addressing table in the style of swiss tables: one control byte per slot holds 7 bits of the hash of the entry
+// in the slot, or marks the slot as empty or deleted, and slots are probed by groups whose 8 control bytes are matched
+// at once as a 64 bit word. a lookup usually reads one group and compares a single key. keys are null, booleans,
+// numbers or strings and keys of different types are never equal, integers and interned strings compare without
+// touching anything else
+struct dict : container {
+    dict() : container{type_id::dict} {}
 
-    std::string to_string() const override {
-        std::string full{"["};
-        for (std::size_t i = 0; i < values.size(); ++i) {
-            full += values.at(i)->to_string();
-            if (i != values.size() - 1) full += ',';
+    std::size_t size() const {
+        return m_size;
+    }
+    // null if there is no such key
+    value* find(const value& key) {
+        auto slot = m_find(key, m_hash(key));
+        return slot == npos ? nullptr : &m_entries[m_index(slot)].val;
+    }
+    void set(const value& key, const value& val) {
+        auto hash = m_hash(key);
+        if (auto slot = m_find(key, hash); slot != npos) {
+            m_entries[m_index(slot)].val = val;
+            return;
         }
-        full += ']';
+        // removed entries are dropped once they take up half of the storage, a key is being added so the entries move
+        // anyway
+        if ((m_used + 1) * 8 > m_capacity() * 7 || m_entries.size() > 2 * m_size + group_size) m_rehash(m_size + 1);
+        auto slot = m_free_slot(hash);
+        if (m_ctrl(slot) == empty) ++m_used;
+        m_fill(slot, hash, m_entries.size());
+        m_entries.push_back(entry{key, val, hash});
+        ++m_size;
+    }
+    bool remove(const value& key) {
+        auto slot = m_find(key, m_hash(key));
+        if (slot == npos) return false;
+        auto& e = m_entries[m_index(slot)];
+        e.key = value::undefined();
+        e.val = value{};
+        // a lookup stops at a group with an empty slot, so no probe runs past this group and the slot can be reused
+        if (m_match_empty(m_word(slot / group_size))) {
+            m_ctrl(slot) = empty;
+            --m_used;
+        } else {
+            m_ctrl(slot) = deleted;
+        }
+        --m_size;
+        return true;
+    }
+
+    // calls 'fn(key, value)' for every entry in insertion order
+    template <class F>
+    void each(F fn) const {
+        for (const auto& e : m_entries)
+            if (!e.key.is_undefined()) fn(e.key, e.val);
+    }
+
+    std::string to_string() const override {
+        std::string full{"{"};
+        each([&](const value& key, const value& val) {
+            if (full.size() > 1) full += ',';
+            full += key.to_string();
+            full += ':';
+            full += val.to_string();
+        });
+        full += '}';
         return full;
     }
     std::string type_to_string() const override {
-        return "array";
+        return "dict";
+    }
+    value subscript(const value& idx) override {
+        if (auto val = find(idx)) return *val;
+        throw skai::exception{fmt::format("key '{}' not found", idx.to_string())};
+    }
+    void set_subscript(const value& idx, const value& val) override {
+        set(idx, val);
+    }
+    void trace(tracer& t) override {
+        for (const auto& e : m_entries) {
+            t(e.key);
+            t(e.val);
+        }
+    }
+    void clear() override {
+        auto entries = std::move(m_entries);
+        m_entries.clear();
+        m_size = 0;
+        m_rehash(0);
+    }
+
+    // the keys in insertion order, the cursor is the position in the entries. removing keys leaves the entries in place
+    // so a loop can remove what it walks over, only adding keys compacts them
+    bool next(std::int64_t& cursor, value& out) override {
+        while (cursor < static_cast<std::int64_t>(m_entries.size())) {
+            const auto& e = m_entries[cursor++];
+            if (e.key.is_undefined()) continue;
+            out = e.key;
+            return true;
+        }
+        return false;
+    }
+    // 'keys()' and 'values()' in insertion order
+    value method(std::string_view name, const value* args, std::size_t argc, invoker& inv) override {
+        bool keys = name == "keys";
+        if (!keys && name != "values") return object::method(name, args, argc, inv);
+        check_arity(argc, 0, 0);
+        std::vector<value> out;
+        out.reserve(m_size);
+        each([&](const value& key, const value& val) { out.push_back(keys ? key : val); });
+        return make<array>(std::move(out));
+    }
+
+   private:
+    struct entry {
+        value key;
+        value val;
+        std::uint64_t hash;
+    };
+    static constexpr std::size_t group_size = 8;
+    // the control bytes and the entry indices of a group share a cache line
+    struct group {
+        std::uint8_t ctrl[group_size];
+        std::uint32_t index[group_size];
+    };
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+    // full slots hold the low 7 bits of the hash, the high bit tells the other two states apart
+    static constexpr std::uint8_t empty = 0x80;
+    static constexpr std::uint8_t deleted = 0xfe;
+    static constexpr std::uint64_t lsbs = 0x0101010101010101;
+    static constexpr std::uint64_t msbs = 0x8080808080808080;
+
+    static std::uint64_t m_mix(std::uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccd;
+        x ^= x >> 33;
+        return x;
+    }
+    static std::uint64_t m_hash(const value& key) {
+        switch (key.id()) {
+            case type_id::null:
+                return m_mix(0);
+            case type_id::boolean:
+                return m_mix(key.as_bool() + 1);
+            case type_id::integer:
+                return m_mix(static_cast<std::uint64_t>(key.as_int()));
+            case type_id::floating: {
+                // 0.0 and -0.0 are equal keys
+                double d = key.as_float() == 0 ? 0.0 : key.as_float();
+                std::uint64_t bits;
+                std::memcpy(&bits, &d, sizeof bits);
+                return m_mix(bits);
+            }
+            case type_id::string:
+                return m_mix(static_cast<string*>(key.as_object())->hash());
+        }
+        throw skai::exception{fmt::format("'{}' can't be used as a dict key", key.type_to_string())};
     }
-    std::shared_ptr<object> operator[](const std::shared_ptr<object>& idx) override {
-        if (auto i = dynamic_cast<integer*>(idx.get())) {
-            std::size_t start = 0;
-            if (i->value < 0) start = values.size();
-            try {
-                return values.at(start + i->value);
-            } catch (std::out_of_range&) { throw skai::exception{fmt::format("out of bounds index '{}'", i->value)}; }
+    static bool m_equal(const value& lhs, const value& rhs) {
+        if (lhs.is_int()) return rhs.is_int() && lhs.as_int() == rhs.as_int();
+        if (lhs.id() != rhs.id()) return false;
+        switch (lhs.id()) {
+            case type_id::boolean:
+                return lhs.as_bool() == rhs.as_bool();
+            case type_id::floating:
+                return lhs.as_float() == rhs.as_float();
+            case type_id::string:
+                return string::equal(*static_cast<string*>(lhs.as_object()), *static_cast<string*>(rhs.as_object()));
         }
-        throw skai::exception{
-            fmt::format("expected type integer in array subscript operator got '{}' instead", idx->type_to_string())};
+        return true;
     }
+
+    std::size_t m_capacity() const {
+        return m_groups.size() * group_size;
+    }
+    std::uint8_t& m_ctrl(std::size_t slot) {
+        return m_groups[slot / group_size].ctrl[slot % group_size];
+    }
+    std::uint32_t m_index(std::size_t slot) const {
+        return m_groups[slot / group_size].index[slot % group_size];
+    }
+    void m_fill(std::size_t slot, std::uint64_t hash, std::size_t index) {
+        m_ctrl(slot) = static_cast<std::uint8_t>(hash & 0x7f);
+        m_groups[slot / group_size].index[slot % group_size] = static_cast<std::uint32_t>(index);
+    }
+    std::uint64_t m_word(std::size_t group) const {
+        std::uint64_t word;
+        std::memcpy(&word, m_groups[group].ctrl, sizeof word);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        word = __builtin_bswap64(word);
+#endif
+        return word;
+    }
+    // the high bit of every byte of 'group' equal to 'h2' is set, a byte above a match may be a false positive
+    static std::uint64_t m_match(std::uint64_t group, std::uint64_t h2) {
+        auto x = group ^ (lsbs * h2);
+        return (x - lsbs) & ~x & msbs;
+    }
+    static std::uint64_t m_match_empty(std::uint64_t group) {
+        return group & ~(group << 6) & msbs;
+    }
+    static std::size_t m_lowest(std::uint64_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<std::size_t>(__builtin_ctzll(mask)) / 8;
+#else
+        std::size_t byte = 0;
+        while (!(mask & 0x80)) {
+            mask >>= 8;
+            ++byte;
+        }
+        return byte;
+#endif
+    }
+
+    // groups are probed in triangular steps, which visits all of them since their count is a power of two
+    std::size_t m_find(const value& key, std::uint64_t hash) const {
+        if (m_size == 0) return npos;
+        auto mask = m_groups.size() - 1;
+        auto at = (hash >> 7) & mask;
+        for (std::size_t step = 1;; at = (at + step++) & mask) {
+            const auto& grp = m_groups[at];
+            auto word = m_word(at);
+            for (auto match = m_match(word, hash & 0x7f); match != 0; match &= match - 1) {
+                auto i = m_lowest(match);
+                if (grp.ctrl[i] >= empty) continue;
+                const auto& e = m_entries[grp.index[i]];
+                if (e.hash == hash && m_equal(e.key, key)) return at * group_size + i;
+            }
+            if (m_match_empty(word)) return npos;
+        }
+    }
+    std::size_t m_free_slot(std::uint64_t hash) const {
+        auto mask = m_groups.size() - 1;
+        auto at = (hash >> 7) & mask;
+        for (std::size_t step = 1;; at = (at + step++) & mask) {
+            if (auto free = m_word(at) & msbs) return at * group_size + m_lowest(free);
+        }
+    }
+    // rebuilds the index for 'count' entries, removed entries are dropped on the way
+    void m_rehash(std::size_t count) {
+        std::size_t capacity = group_size;
+        while (capacity * 7 < count * 8 + 8) capacity *= 2;
+        m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(),
+                                       [](const entry& e) { return e.key.is_undefined(); }),
+                        m_entries.end());
+        group none;
+        std::fill(std::begin(none.ctrl), std::end(none.ctrl), empty);
+        m_groups.assign(capacity / group_size, none);
+        for (std::size_t i = 0; i < m_entries.size(); ++i) m_fill(m_free_slot(m_entries[i].hash), m_entries[i].hash, i);
+        m_used = m_entries.size();
+    }
+
+    std::vector<entry> m_entries;
+    std::vector<group> m_groups;
+    std::size_t m_size = 0;
+    // slots that aren't empty, full or deleted
+    std::size_t m_used = 0;
 };
-struct variable : object {
-    std::string name;
-    bool is_const;
-    std::shared_ptr<object> value;
 
-    variable(const std::string& n, bool i, const std::shared_ptr<object>& v) : name{n}, is_const{i}, value{v} {}
+// 'substr(begin, count = rest)' and 'split(separator = whitespace)', the results share the buffer of the string
+inline value string::method(std::string_view name, const value* args, std::size_t argc, invoker& inv) {
+    auto text = view();
+    if (name == "substr") {
+        check_arity(argc, 1, 2);
+        auto size = static_cast<std::int64_t>(text.size());
+        auto begin = m_bound(args[0], 0, "begin");
+        if (begin < 0) begin += size;
+        if (begin < 0 || begin > size)
+            throw skai::exception{fmt::format("out of bounds index '{}'", args[0].as_int())};
+        auto count = argc > 1 ? m_bound(args[1], size, "count") : size;
+        if (count < 0) throw skai::exception{fmt::format("negative substring count '{}'", count)};
+        return m_slice(begin, begin + std::min(count, size - begin));
+    }
+    if (name == "split") {
+        check_arity(argc, 0, 1);
+        std::vector<value> parts;
+        if (argc == 0) {
+            // runs of whitespace separate the parts, there are no empty ones
+            std::size_t at = 0;
+            while (true) {
+                at = text.find_first_not_of(" \t\r\n\v\f", at);
+                if (at == std::string_view::npos) break;
+                auto end = std::min(text.find_first_of(" \t\r\n\v\f", at), text.size());
+                parts.push_back(m_slice(at, end));
+                at = end;
+            }
+            return make<array>(std::move(parts));
+        }
+        if (args[0].id() != type_id::string)
+            throw skai::exception{
+                fmt::format("expected type string as separator got '{}' instead", args[0].type_to_string())};
+        auto sep = static_cast<string*>(args[0].as_object())->view();
+        if (sep.empty()) throw skai::exception{"empty separator"};
+        std::size_t at = 0;
+        while (true) {
+            auto end = text.find(sep, at);
+            parts.push_back(m_slice(at, end == std::string_view::npos ? text.size() : end));
+            if (end == std::string_view::npos) break;
+            at = end + sep.size();
+        }
+        return make<array>(std::move(parts));
+    }
+    return object::method(name, args, argc, inv);
+}
+
+// binary operators dispatch through a table indexed by operator, left and right operand type, generated at compile
+// time. integers and floats mix for arithmetic and comparisons, the integer is converted. pairs without an entry go
+// through 'generic_binary'
+inline constexpr token binary_ops[] = {token::plus,   token::minus,  token::star,    token::slash, token::mod,
+                                       token::b_and,  token::b_or,   token::xor_,    token::lshift, token::rshift,
+                                       token::d_eq,   token::not_eq_, token::lt,     token::lt_eq, token::gt,
+                                       token::gt_eq};
+constexpr std::size_t binary_op_count = sizeof(binary_ops) / sizeof(binary_ops[0]);
+constexpr std::size_t type_count = static_cast<std::size_t>(type_id::count);
+using binary_fn = value (*)(token, const value&, const value&);
+
+inline value generic_binary(token op, const value& lhs, const value& rhs) {
+    if (lhs.is_object() && !rhs.is_null()) return lhs.as_object()->binary(op, rhs);
+    // null only compares equal to itself
+    if (lhs.is_null() || rhs.is_null()) {
+        if (op == token::d_eq) return value::boolean(lhs.type() == rhs.type());
+        if (op == token::not_eq_) return value::boolean(lhs.type() != rhs.type());
+    }
+    invalid_operands(op, lhs, rhs);
+}
+template <token Op>
+value int_int(token, const value& lhs, const value& rhs) {
+    return int_binary(Op, lhs.as_int(), rhs.as_int());
+}
+template <token Op>
+value float_float(token, const value& lhs, const value& rhs) {
+    return float_binary(Op, lhs.as_float(), rhs.as_float());
+}
+template <token Op>
+value int_float(token, const value& lhs, const value& rhs) {
+    return float_binary(Op, static_cast<double>(lhs.as_int()), rhs.as_float());
+}
+template <token Op>
+value float_int(token, const value& lhs, const value& rhs) {
+    return float_binary(Op, lhs.as_float(), static_cast<double>(rhs.as_int()));
+}
+template <token Op>
+value bool_bool(token, const value& lhs, const value& rhs) {
+    return value::boolean((lhs.as_bool() == rhs.as_bool()) == (Op == token::d_eq));
+}
+template <token Op>
+value string_string(token, const value& lhs, const value& rhs) {
+    auto& ls = *static_cast<string*>(lhs.as_object());
+    auto& rs = *static_cast<string*>(rhs.as_object());
+    if constexpr (Op == token::d_eq) return value::boolean(string::equal(ls, rs));
+    if constexpr (Op == token::not_eq_) return value::boolean(!string::equal(ls, rs));
+    auto l = ls.view(), r = rs.view();
+    switch (Op) {
+        case token::plus: {
+            std::string out;
+            out.reserve(l.size() + r.size());
+            return make<string>(std::move(out.append(l).append(r)));
+        }
+        case token::lt:
+            return value::boolean(l < r);
+        case token::lt_eq:
+            return value::boolean(l <= r);
+        case token::gt:
+            return value::boolean(l > r);
+        case token::gt_eq:
+            return value::boolean(l >= r);
+    }
+    invalid_operands(Op, lhs, rhs);
+}
+
+value elementwise(token op, const value& lhs, const value& rhs);
+
+// the last row is for tokens that aren't binary operators
+struct binary_table {
+    binary_fn fns[binary_op_count + 1][type_count][type_count];
+};
+template <std::size_t I>
+constexpr void fill_binary(binary_table& table) {
+    constexpr token op = binary_ops[I];
+    constexpr auto b = static_cast<std::size_t>(type_id::boolean);
+    constexpr auto i = static_cast<std::size_t>(type_id::integer);
+    constexpr auto f = static_cast<std::size_t>(type_id::floating);
+    constexpr auto s = static_cast<std::size_t>(type_id::string);
+    constexpr bool equality = op == token::d_eq || op == token::not_eq_;
+    constexpr bool ordering = equality || op == token::lt || op == token::lt_eq || op == token::gt || op == token::gt_eq;
+    constexpr bool arithmetic =
+        op == token::plus || op == token::minus || op == token::star || op == token::slash || op == token::mod;
+    auto& row = table.fns[I];
+    row[i][i] = int_int<op>;
+    if constexpr (arithmetic || ordering) {
+        row[f][f] = float_float<op>;
+        row[i][f] = int_float<op>;
+        row[f][i] = float_int<op>;
+    }
+    if constexpr (equality) row[b][b] = bool_bool<op>;
+    if constexpr (ordering || op == token::plus) row[s][s] = string_string<op>;
+    if constexpr (ordering || arithmetic) {
+        constexpr auto a = static_cast<std::size_t>(type_id::array);
+        for (auto t : {b, i, f, s, a}) row[a][t] = row[t][a] = elementwise;
+    }
+}
+template <std::size_t... I>
+constexpr binary_table make_binary_table(std::index_sequence<I...>) {
+    binary_table table{};
+    for (auto& row : table.fns)
+        for (auto& lhs : row)
+            for (auto& fn : lhs) fn = generic_binary;
+    (fill_binary<I>(table), ...);
+    return table;
+}
+inline constexpr binary_table binary_dispatch = make_binary_table(std::make_index_sequence<binary_op_count>{});
+
+// row of every token in 'binary_dispatch'
+constexpr std::array<std::uint8_t, 256> make_binary_rows() {
+    std::array<std::uint8_t, 256> rows{};
+    for (auto& row : rows) row = binary_op_count;
+    for (std::size_t i = 0; i < binary_op_count; ++i) rows[static_cast<std::uint8_t>(binary_ops[i])] = i;
+    return rows;
+}
+inline constexpr auto binary_rows = make_binary_rows();
+
+// arithmetic and comparisons
+inline value binary(token op, const value& lhs, const value& rhs) {
+    // integer and float arithmetic skip the table
+    if (lhs.is_int() && rhs.is_int()) return int_binary(op, lhs.as_int(), rhs.as_int());
+    if (lhs.is_float() && rhs.is_float()) return float_binary(op, lhs.as_float(), rhs.as_float());
+    const auto& row = binary_dispatch.fns[binary_rows[static_cast<std::uint8_t>(op)]];
+    return row[static_cast<std::size_t>(lhs.id())][static_cast<std::size_t>(rhs.id())](op, lhs, rhs);
+}
+
+// calls 'run(AScalar, BScalar)' with the shape of the operands of an element-wise operator as integral constants, at
+// least one of them is an array
+template <class F>
+void by_shape(bool lhs_scalar, bool rhs_scalar, F&& run) {
+    if (lhs_scalar)
+        run(std::true_type{}, std::false_type{});
+    else if (rhs_scalar)
+        run(std::false_type{}, std::true_type{});
+    else
+        run(std::false_type{}, std::false_type{});
+}
+template <class T>
+bool compare(token op, T l, T r) {
+    switch (op) {
+        case token::d_eq:
+            return l == r;
+        case token::not_eq_:
+            return l != r;
+        case token::lt:
+            return l < r;
+        case token::lt_eq:
+            return l <= r;
+        case token::gt:
+            return l > r;
+    }
+    return l >= r;
+}
+
+// element-wise operators on arrays, between two arrays of the same size or an array and a single value. float
+// arithmetic and integer '+' '-' on typed arrays run the simd kernels, the other operators on typed arrays a loop over
+// the unboxed elements and everything else goes element by element through 'binary'
+inline value elementwise(token op, const value& lhs, const value& rhs) {
+    auto* la = lhs.id() == type_id::array ? static_cast<array*>(lhs.as_object()) : nullptr;
+    auto* ra = rhs.id() == type_id::array ? static_cast<array*>(rhs.as_object()) : nullptr;
+    if (la && ra && la->size() != ra->size())
+        throw skai::exception{fmt::format("element-wise '{}' between arrays of size {} and {}", token_str(op),
+                                          la->size(), ra->size())};
+    auto n = la ? la->size() : ra->size();
+    auto typed = [&](array::kind k, type_id id) {
+        return (la ? la->elements() == k : lhs.id() == id) && (ra ? ra->elements() == k : rhs.id() == id);
+    };
+    bool ordering = op == token::d_eq || op == token::not_eq_ || op == token::lt || op == token::lt_eq ||
+                    op == token::gt || op == token::gt_eq;
+
+    if (typed(array::kind::floating, type_id::floating) && op != token::mod) {
+        double ls = lhs.is_float() ? lhs.as_float() : 0, rs = rhs.is_float() ? rhs.as_float() : 0;
+        const double* l = la ? la->floats() : &ls;
+        const double* r = ra ? ra->floats() : &rs;
+        if (ordering) {
+            std::vector<std::uint8_t> out(n);
+            for (std::size_t i = 0; i < n; ++i) out[i] = compare(op, l[la ? i : 0], r[ra ? i : 0]);
+            return make<array>(std::move(out));
+        }
+        std::vector<double> out(n);
+        by_shape(!la, !ra, [&](auto a, auto b) {
+            constexpr bool as = decltype(a)::value, bs = decltype(b)::value;
+            if (op == token::plus) simd::f64<simd::arith::add, as, bs>(l, r, out.data(), n);
+            if (op == token::minus) simd::f64<simd::arith::sub, as, bs>(l, r, out.data(), n);
+            if (op == token::star) simd::f64<simd::arith::mul, as, bs>(l, r, out.data(), n);
+            if (op == token::slash) simd::f64<simd::arith::div, as, bs>(l, r, out.data(), n);
+        });
+        return make<array>(std::move(out));
+    }
+    if (typed(array::kind::integer, type_id::integer) && (ordering || op == token::plus || op == token::minus ||
+                                                          op == token::star)) {
+        std::int64_t ls = lhs.is_int() ? lhs.as_int() : 0, rs = rhs.is_int() ? rhs.as_int() : 0;
+        const std::int64_t* l = la ? la->ints() : &ls;
+        const std::int64_t* r = ra ? ra->ints() : &rs;
+        if (ordering) {
+            std::vector<std::uint8_t> out(n);
+            for (std::size_t i = 0; i < n; ++i) out[i] = compare(op, l[la ? i : 0], r[ra ? i : 0]);
+            return make<array>(std::move(out));
+        }
+        std::vector<std::int64_t> out(n);
+        if (op == token::star) {
+            for (std::size_t i = 0; i < n; ++i) out[i] = checked(op, l[la ? i : 0], r[ra ? i : 0]);
+            return make<array>(std::move(out));
+        }
+        bool ok = true;
+        by_shape(!la, !ra, [&](auto a, auto b) {
+            constexpr bool as = decltype(a)::value, bs = decltype(b)::value;
+            ok = op == token::minus ? simd::i64<true, as, bs>(l, r, out.data(), n)
+                                    : simd::i64<false, as, bs>(l, r, out.data(), n);
+        });
+        if (!ok) throw skai::exception{"integer overflow"};
+        return make<array>(std::move(out));
+    }
+    std::vector<value> out;
+    out.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) out.push_back(binary(op, la ? la->at(i) : lhs, ra ? ra->at(i) : rhs));
+    return make<array>(std::move(out));
+}
+
+// the result of an interpolated string literal. the parts are written into a buffer on the stack (it only moves to
+// the heap for long results) and the string is allocated once with its final size
+inline value interpolate(const value* parts, std::size_t count) {
+    fmt::memory_buffer out;
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto& part = parts[i];
+        if (part.id() == type_id::string) {
+            auto str = static_cast<string*>(part.as_object())->view();
+            out.append(str.data(), str.data() + str.size());
+        } else if (part.is_int()) {
+            fmt::format_to(std::back_inserter(out), "{}", part.as_int());
+        } else {
+            auto str = part.to_string();
+            out.append(str.data(), str.data() + str.size());
+        }
+    }
+    return make<string>(std::string(out.data(), out.size()));
+}
+
+// appends 'rhs' to the string in 'lhs' when nothing else references it, returns false if that's not possible. a string
+// built up in a loop then grows its buffer geometrically instead of being copied on every '+'
+inline bool append_in_place(value& lhs, const value& rhs) {
+    if (lhs.id() != type_id::string || rhs.id() != type_id::string || lhs.as_object()->refs() != 1) return false;
+    return static_cast<string*>(lhs.as_object())->append(static_cast<string*>(rhs.as_object())->view());
+}
+// 'lhs = lhs op rhs', for compound assignments and temporaries
+inline void binary_assign(token op, value& lhs, const value& rhs) {
+    if (op == token::plus && append_in_place(lhs, rhs)) return;
+    lhs = binary(op, lhs, rhs);
+}
+
+// the lazy result of 'map' and 'filter' on an array. chaining more of them adds a step instead of running anything,
+// the steps run in a single pass over the source once the elements are needed: by 'collect()', 'reduce', 'each', any
+// other array method, a subscript or converting it to a string. 'reduce' and 'each' don't build an array at all,
+// everything else collects one and keeps it so that the functions run only once
+struct pipeline : container {
+    struct step {
+        bool filter;
+        value fn;
+    };
+
+    pipeline(const ref<array>& source, std::vector<step> steps, invoker& inv)
+        : m_source{source}, m_steps{std::move(steps)}, m_invoker{&inv} {}
 
     std::string to_string() const override {
-        return value->to_string();
+        return collect()->to_string();
     }
     std::string type_to_string() const override {
-        return value->type_to_string();
-    }
-#define VAR_ADD_OP_RET(op)                                                             \
-    std::shared_ptr<object> operator op(const std::shared_ptr<object>& obj) override { \
-        if (auto v = dynamic_cast<variable*>(obj.get()))                               \
-            return value.get()->operator op(v->value);                                 \
-        else                                                                           \
-            return value.get()->operator op(obj);                                      \
-    }
-#define VAR_ADD_OP(op)                                                                    \
-    std::shared_ptr<object> operator op##=(const std::shared_ptr<object>& obj) override { \
-        if (auto v = dynamic_cast<variable*>(obj.get()))                                  \
-            value = value.get()->operator op(v->value);                                   \
-        else                                                                              \
-            value = value.get()->operator op(obj);                                        \
-        return value;                                                                     \
-    }                                                                                     \
-    VAR_ADD_OP_RET(op)
-
-    VAR_ADD_OP(+)
-    VAR_ADD_OP(-)
-    VAR_ADD_OP(/)
-    VAR_ADD_OP(*)
-    VAR_ADD_OP(^)
-    VAR_ADD_OP(|)
-    VAR_ADD_OP(>>)
-    VAR_ADD_OP(<<)
-    VAR_ADD_OP_RET(>)
-    VAR_ADD_OP_RET(>=)
-    VAR_ADD_OP_RET(<)
-    VAR_ADD_OP_RET(<=)
-    VAR_ADD_OP(&)
-    VAR_ADD_OP(%)
+        return "pipeline";
+    }
+    value subscript(const value& idx) override {
+        return collect()->subscript(idx);
+    }
+    bool next(std::int64_t& cursor, value& out) override {
+        return collect()->next(cursor, out);
+    }
+
+    void trace(tracer& t) override {
+        t(m_source);
+        for (const auto& st : m_steps) t(st.fn);
+        t(m_result);
+    }
+    void clear() override {
+        m_source = {};
+        m_steps.clear();
+        m_result = {};
+    }
+    value method(std::string_view name, const value* args, std::size_t argc, invoker& inv) override;
+
+    const ref<array>& collect() const {
+        if (m_result) return m_result;
+        std::vector<value> out;
+        out.reserve(m_source->size());
+        run([&](value& elm) { out.push_back(std::move(elm)); });
+        m_result = make<array>(std::move(out));
+        return m_result;
+    }
+    // passes every element that gets through the steps to 'sink'
+    template <class F>
+    void run(F&& sink) const {
+        // the functions may write to the source, its size is read again for every element
+        for (std::size_t i = 0; i < m_source->size(); ++i) {
+            auto elm = m_source->at(i);
+            if (m_apply(elm)) sink(elm);
+        }
+    }
+
+   private:
+    bool m_apply(value& elm) const {
+        for (const auto& st : m_steps) {
+            auto out = m_invoker->invoke(st.fn, &elm, 1);
+            if (!st.filter) {
+                elm = std::move(out);
+            } else if (!out.is_bool() && !out.is_null()) {
+                throw skai::exception{"implicit conversions to booleans are disallowed"};
+            } else if (!out.is_bool() || !out.as_bool()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    ref<array> m_source;
+    std::vector<step> m_steps;
+    invoker* m_invoker;
+    mutable ref<array> m_result;
 };
 
+inline value pipeline::method(std::string_view name, const value* args, std::size_t argc, invoker& inv) {
+    // once collected it behaves like the array, a further 'map' starts from there
+    if (m_result) return m_result->method(name, args, argc, inv);
+    if (name == "map" || name == "filter") {
+        check_arity(argc, 1, 1);
+        auto steps = m_steps;
+        steps.push_back(step{name == "filter", args[0]});
+        return make<pipeline>(m_source, std::move(steps), inv);
+    }
+    if (name == "collect") {
+        check_arity(argc, 0, 0);
+        return collect();
+    }
+    if (name == "reduce") {
+        check_arity(argc, 1, 2);
+        bool first = argc == 1;
+        value acc = first ? value{} : args[1];
+        run([&](value& elm) {
+            if (std::exchange(first, false)) {
+                acc = std::move(elm);
+                return;
+            }
+            value pair[] = {std::move(acc), std::move(elm)};
+            acc = inv.invoke(args[0], pair, 2);
+        });
+        if (first) throw skai::exception{"'reduce' of an empty array with no initial value"};
+        return acc;
+    }
+    if (name == "each") {
+        check_arity(argc, 1, 1);
+        run([&](value& elm) { inv.invoke(args[0], &elm, 1); });
+        return value{};
+    }
+    return collect()->method(name, args, argc, inv);
+}
+
+inline value array::method(std::string_view name, const value* args, std::size_t argc, invoker& inv) {
+    if (name == "map" || name == "filter") {
+        check_arity(argc, 1, 1);
+        std::vector<pipeline::step> steps{pipeline::step{name == "filter", args[0]}};
+        return make<pipeline>(ref<array>{this}, std::move(steps), inv);
+    }
+    // the same single pass, without any step
+    if (name == "reduce" || name == "each")
+        return make<pipeline>(ref<array>{this}, std::vector<pipeline::step>{}, inv)->method(name, args, argc, inv);
+    if (name == "collect") {
+        check_arity(argc, 0, 0);
+        return value{this};
+    }
+    if (name == "sum") {
+        check_arity(argc, 0, 0);
+        if (m_kind == kind::floating) return value::floating(simd::sum(m_floats.data(), m_floats.size()));
+        if (m_kind == kind::integer) {
+            std::int64_t total{};
+            if (!simd::sum(m_ints.data(), m_ints.size(), total)) throw skai::exception{"integer overflow"};
+            return value::integer(total);
+        }
+        if (size() == 0) return value::integer(0);
+        auto total = at(0);
+        for (std::size_t i = 1; i < size(); ++i) binary_assign(token::plus, total, at(i));
+        return total;
+    }
+    if (name == "min" || name == "max") {
+        check_arity(argc, 0, 0);
+        bool max = name == "max";
+        if (size() == 0) throw skai::exception{fmt::format("'{}' of an empty array", name)};
+        if (m_kind == kind::floating)
+            return value::floating(max ? simd::extreme<true>(m_floats.data(), m_floats.size())
+                                       : simd::extreme<false>(m_floats.data(), m_floats.size()));
+        if (m_kind == kind::integer)
+            return value::integer(max ? simd::extreme<true>(m_ints.data(), m_ints.size())
+                                      : simd::extreme<false>(m_ints.data(), m_ints.size()));
+        auto best = at(0);
+        for (std::size_t i = 1; i < size(); ++i) {
+            auto elm = at(i);
+            if (skai::object::binary(max ? token::gt : token::lt, elm, best).as_bool()) best = elm;
+        }
+        return best;
+    }
+    if (name == "dot") {
+        check_arity(argc, 1, 1);
+        if (args[0].id() != type_id::array)
+            throw skai::exception{
+                fmt::format("expected type array in 'dot' got '{}' instead", args[0].type_to_string())};
+        const auto& other = *static_cast<array*>(args[0].as_object());
+        if (other.size() != size())
+            throw skai::exception{fmt::format("'dot' between arrays of size {} and {}", size(), other.size())};
+        if (m_kind == kind::floating && other.m_kind == kind::floating)
+            return value::floating(simd::dot(m_floats.data(), other.m_floats.data(), size()));
+        if (m_kind == kind::integer && other.m_kind == kind::integer) {
+            std::int64_t total = 0;
+            for (std::size_t i = 0; i < size(); ++i)
+                total = checked(token::plus, total, checked(token::star, m_ints[i], other.m_ints[i]));
+            return value::integer(total);
+        }
+        auto total = value::integer(0);
+        for (std::size_t i = 0; i < size(); ++i)
+            binary_assign(token::plus, total, skai::object::binary(token::star, at(i), other.at(i)));
+        return total;
+    }
+    return object::method(name, args, argc, inv);
+}
+
 }  // namespace object
 }  // namespace skai
 #endif
@@ -0,0 +1,335 @@
+#ifndef SKAI_OPTIMIZER_HPP_61E0CA2D93B7
+#define SKAI_OPTIMIZER_HPP_61E0CA2D93B7
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ast.hpp"
+#include "error.hpp"
+#include "object.hpp"
+
+namespace skai {
+// rewrites the ast before it is resolved or compiled: operations on literals are folded, 'imm' variables bound to a
+// literal are replaced by it, branches of 'if' on a constant condition and statements following a return, break or
+// continue are dropped. folding goes through the same functions as the backends so results and errors are the same,
+// an operation that would throw is left for the backend to report
+struct optimizer {
+    void optimize(ast& tree) {
+        m_ast = &tree;
+        // a global declared twice may change value between the declarations, functions read globals when they run
+        std::unordered_set<str_ref> seen;
+        for (auto stmt : tree.nodes(tree.program)) {
+            auto name = m_declared(stmt);
+            if (name && !seen.insert(*name).second) m_unstable.insert(*name);
+        }
+        m_scopes.assign(1, {});
+        tree.program = m_stmts(tree.program);
+        m_scopes.clear();
+    }
+
+    std::size_t folded() const {
+        return m_folded;
+    }
+    std::size_t propagated() const {
+        return m_propagated;
+    }
+    std::size_t removed() const {
+        return m_removed;
+    }
+
+   private:
+    const str_ref* m_declared(node_ref ref) {
+        if (m_ast->kind(ref) == node_kind::variable) return &m_ast->get<variable_expr>(ref).name;
+        if (m_ast->kind(ref) == node_kind::function) return &m_ast->get<function_stmt>(ref).name;
+        return nullptr;
+    }
+
+    // 'value' is the literal the name stands for, 0 for a variable that shadows outer constants
+    void m_declare(str_ref name, node_ref value) {
+        if (m_scopes.size() == 1 && m_unstable.count(name)) value = 0;
+        m_scopes.back()[name] = value;
+    }
+    node_ref m_lookup(str_ref name) {
+        for (auto it = m_scopes.rbegin(); it != m_scopes.rend(); ++it)
+            if (auto var = it->find(name); var != it->end()) return var->second;
+        return 0;
+    }
+
+    bool m_literal(node_ref ref) {
+        switch (m_ast->kind(ref)) {
+            case node_kind::num:
+            case node_kind::ldouble:
+            case node_kind::string:
+            case node_kind::bool_:
+                return true;
+        }
+        return false;
+    }
+    bool m_bool(node_ref ref, bool value) {
+        return m_ast->kind(ref) == node_kind::bool_ && m_ast->get<bool_expr>(ref).value == value;
+    }
+
+    object::value m_value(node_ref ref) {
+        switch (m_ast->kind(ref)) {
+            case node_kind::num:
+                return object::value::integer(m_ast->get<num_expr>(ref).value);
+            case node_kind::ldouble:
+                return object::value::floating(m_ast->get<ldouble_expr>(ref).value);
+            case node_kind::bool_:
+                return object::value::boolean(m_ast->get<bool_expr>(ref).value);
+            default:
+                return object::intern(m_ast->str(m_ast->get<string_expr>(ref).value));
+        }
+    }
+    // 0 if the value has no literal form
+    node_ref m_node(const object::value& val) {
+        if (val.is_int()) return m_ast->make<num_expr>(val.as_int());
+        if (val.is_float()) return m_ast->make<ldouble_expr>(val.as_float());
+        if (val.is_bool()) return m_ast->make<bool_expr>(val.as_bool());
+        if (auto str = val.as<object::string>()) return m_ast->make<string_expr>(m_ast->intern(str->view()));
+        return 0;
+    }
+    template <class F>
+    node_ref m_fold(node_ref ref, F eval) {
+        node_ref out = 0;
+        try {
+            out = m_node(eval());
+        } catch (skai::exception&) {}
+        if (out == 0) return ref;
+        ++m_folded;
+        return out;
+    }
+
+    // statements of a block, the list is rebuilt without the ones that can't run
+    list_ref m_stmts(list_ref l) {
+        std::vector<node_ref> stmts{m_ast->nodes(l).begin(), m_ast->nodes(l).end()};
+        std::vector<node_ref> out;
+        for (std::size_t i = 0; i < stmts.size(); ++i) {
+            auto stmt = m_opt(stmts[i]);
+            if (stmt == 0) {
+                ++m_removed;
+                continue;
+            }
+            out.push_back(stmt);
+            auto kind = m_ast->kind(stmt);
+            if (kind == node_kind::return_ || kind == node_kind::break_ || kind == node_kind::continue_) {
+                m_removed += stmts.size() - i - 1;
+                break;
+            }
+        }
+        if (std::equal(out.begin(), out.end(), stmts.begin(), stmts.end())) return l;
+        return m_ast->list(out.data(), out.size());
+    }
+    list_ref m_exprs(list_ref l) {
+        std::vector<node_ref> exprs{m_ast->nodes(l).begin(), m_ast->nodes(l).end()};
+        bool changed = false;
+        for (auto& expr_ : exprs) {
+            auto out = m_opt(expr_);
+            changed |= out != expr_;
+            expr_ = out;
+        }
+        return changed ? m_ast->list(exprs.data(), exprs.size()) : l;
+    }
+
+    // returns the node replacing 'ref', nodes are copied out and written back since folding grows the arena
+    node_ref m_opt(node_ref ref) {
+        auto& tree = *m_ast;
+        switch (tree.kind(ref)) {
+            case node_kind::ident: {
+                auto value = m_lookup(tree.get<ident_expr>(ref).name);
+                if (value == 0) return ref;
+                ++m_propagated;
+                return value;
+            }
+            case node_kind::variable: {
+                auto n = tree.get<variable_expr>(ref);
+                n.value = m_opt(n.value);
+                tree.get<variable_expr>(ref) = n;
+                m_declare(n.name, n.is_const && m_literal(n.value) ? n.value : 0);
+                return ref;
+            }
+            case node_kind::assign: {
+                auto n = tree.get<assign_expr>(ref);
+                if (tree.kind(n.lhs) == node_kind::subscript) n.lhs = m_opt(n.lhs);
+                n.rhs = m_opt(n.rhs);
+                tree.get<assign_expr>(ref) = n;
+                return ref;
+            }
+            case node_kind::binary: {
+                auto n = tree.get<binary_expr>(ref);
+                // the target of a compound assignment stays a name
+                if (compound_base(n.op) == n.op) n.lhs = m_opt(n.lhs);
+                n.rhs = m_opt(n.rhs);
+                tree.get<binary_expr>(ref) = n;
+                if (!m_literal(n.lhs) || !m_literal(n.rhs)) return ref;
+                return m_fold(ref, [&] { return object::binary(n.op, m_value(n.lhs), m_value(n.rhs)); });
+            }
+            case node_kind::logical: {
+                auto n = tree.get<logical_expr>(ref);
+                n.lhs = m_opt(n.lhs);
+                n.rhs = m_opt(n.rhs);
+                tree.get<logical_expr>(ref) = n;
+                bool is_and = n.op == token::and_;
+                // the right operand is skipped or is the result, it has to be a boolean in the latter case
+                if (m_bool(n.lhs, !is_and)) return m_fold(ref, [&] { return object::value::boolean(!is_and); });
+                if (m_bool(n.lhs, is_and) && tree.kind(n.rhs) == node_kind::bool_) {
+                    ++m_folded;
+                    return n.rhs;
+                }
+                return ref;
+            }
+            case node_kind::unary: {
+                auto n = tree.get<unary_expr>(ref);
+                n.operand = m_opt(n.operand);
+                tree.get<unary_expr>(ref) = n;
+                if (!m_literal(n.operand)) return ref;
+                return m_fold(ref, [&] { return object::unary(n.op, m_value(n.operand)); });
+            }
+            case node_kind::call: {
+                auto n = tree.get<call_expr>(ref);
+                n.callee = m_opt(n.callee);
+                n.arguments = m_exprs(n.arguments);
+                tree.get<call_expr>(ref) = n;
+                return ref;
+            }
+            case node_kind::array: {
+                auto elements = m_exprs(tree.get<array_expr>(ref).elements);
+                tree.get<array_expr>(ref).elements = elements;
+                return ref;
+            }
+            case node_kind::dict: {
+                auto entries = m_exprs(tree.get<dict_expr>(ref).entries);
+                tree.get<dict_expr>(ref).entries = entries;
+                return ref;
+            }
+            case node_kind::interpolation: {
+                auto parts = m_exprs(tree.get<interpolation_expr>(ref).parts);
+                tree.get<interpolation_expr>(ref).parts = parts;
+                std::vector<object::value> values;
+                for (auto part : tree.nodes(parts)) {
+                    if (!m_literal(part)) return ref;
+                    values.push_back(m_value(part));
+                }
+                return m_fold(ref, [&] { return object::interpolate(values.data(), values.size()); });
+            }
+            case node_kind::subscript: {
+                auto n = tree.get<subscript_expr>(ref);
+                n.object = m_opt(n.object);
+                n.target = m_opt(n.target);
+                tree.get<subscript_expr>(ref) = n;
+                return ref;
+            }
+            case node_kind::slice: {
+                auto n = tree.get<slice_expr>(ref);
+                n.object = m_opt(n.object);
+                n.begin = m_opt(n.begin);
+                n.end = m_opt(n.end);
+                tree.get<slice_expr>(ref) = n;
+                return ref;
+            }
+            case node_kind::range: {
+                auto n = tree.get<range_expr>(ref);
+                n.begin = m_opt(n.begin);
+                n.end = m_opt(n.end);
+                n.step = m_opt(n.step);
+                tree.get<range_expr>(ref) = n;
+                return ref;
+            }
+            case node_kind::access: {
+                auto target = m_opt(tree.get<access_expr>(ref).target);
+                tree.get<access_expr>(ref).target = target;
+                return ref;
+            }
+            case node_kind::return_: {
+                auto value = m_opt(tree.get<return_stmt>(ref).value);
+                tree.get<return_stmt>(ref).value = value;
+                return ref;
+            }
+            case node_kind::block: {
+                m_scopes.emplace_back();
+                auto stmts = m_stmts(tree.get<block_stmt>(ref).stmts);
+                m_scopes.pop_back();
+                tree.get<block_stmt>(ref).stmts = stmts;
+                return ref;
+            }
+            case node_kind::if_: {
+                auto n = tree.get<if_stmt>(ref);
+                m_scopes.emplace_back();
+                n.init = m_opt(n.init);
+                n.condition = m_opt(n.condition);
+                n.then_branch = m_opt(n.then_branch);
+                n.else_branch = m_opt(n.else_branch);
+                m_scopes.pop_back();
+                tree.get<if_stmt>(ref) = n;
+                if (n.init != 0 || tree.kind(n.condition) != node_kind::bool_) return ref;
+                ++m_removed;
+                return tree.get<bool_expr>(n.condition).value ? n.then_branch : n.else_branch;
+            }
+            case node_kind::while_: {
+                auto n = tree.get<while_stmt>(ref);
+                m_scopes.emplace_back();
+                n.init = m_opt(n.init);
+                n.branch = m_opt(n.branch);
+                n.body = m_opt(n.body);
+                m_scopes.pop_back();
+                tree.get<while_stmt>(ref) = n;
+                return n.init == 0 && m_bool(n.branch, false) ? 0 : ref;
+            }
+            case node_kind::for_: {
+                auto n = tree.get<for_stmt>(ref);
+                m_scopes.emplace_back();
+                n.init = m_opt(n.init);
+                n.condition = m_opt(n.condition);
+                n.branch = m_opt(n.branch);
+                n.body = m_opt(n.body);
+                m_scopes.pop_back();
+                tree.get<for_stmt>(ref) = n;
+                return ref;
+            }
+            case node_kind::iterate: {
+                auto n = tree.get<iterate_stmt>(ref);
+                m_scopes.emplace_back();
+                n.iterable = m_opt(n.iterable);
+                m_declare(n.name, 0);
+                n.body = m_opt(n.body);
+                m_scopes.pop_back();
+                tree.get<iterate_stmt>(ref) = n;
+                return ref;
+            }
+            case node_kind::function:
+                m_declare(tree.get<function_stmt>(ref).name, 0);
+                return m_function(ref);
+            case node_kind::lambda:
+                m_function(tree.get<lambda_expr>(ref).function);
+                return ref;
+            default:
+                return ref;
+        }
+    }
+
+    node_ref m_function(node_ref ref) {
+        auto n = m_ast->get<function_stmt>(ref);
+        m_scopes.emplace_back();
+        std::vector<node_ref> args{m_ast->nodes(n.arguments).begin(), m_ast->nodes(n.arguments).end()};
+        for (auto arg : args) m_declare(m_ast->get<argument_expr>(arg).name, 0);
+        for (auto arg : args) {
+            auto def = m_opt(m_ast->get<argument_expr>(arg).def);
+            m_ast->get<argument_expr>(arg).def = def;
+        }
+        n.body = m_stmts(n.body);
+        m_scopes.pop_back();
+        m_ast->get<function_stmt>(ref).body = n.body;
+        return ref;
+    }
+
+    ast* m_ast{};
+    std::vector<std::unordered_map<str_ref, node_ref>> m_scopes;
+    std::unordered_set<str_ref> m_unstable;
+    std::size_t m_folded = 0;
+    std::size_t m_propagated = 0;
+    std::size_t m_removed = 0;
+};
+}  // namespace skai
+#endif
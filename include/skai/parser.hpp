@@ -1,7 +1,9 @@
 #ifndef SKAI_PARSER_HPP_739300303
 #define SKAI_PARSER_HPP_739300303
-#include <memory>
+#include <charconv>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "ast.hpp"
@@ -10,68 +12,211 @@
 #include "sloc.hpp"
 namespace skai {
 struct parser {
-    parser(const std::vector<token_handler> tkns, const std::string& file) : m_src{tkns}, m_file{file} {}
+    parser(std::vector<token_handler> tkns, const source_file& src) : m_src{std::move(tkns)}, m_file{src} {
+        // scripts take one to two words of nodes per token, saves regrowing the arena on big ones
+        m_ast.reserve(m_src.size() * 2);
+    }
 
    private:
-    auto m_get() {
-        return m_src.at(at_end() ? m_src.size() - 1 : m_pos);
+    // tokens are handed out by reference, the parser never copies them
+    const token_handler& m_get() const {
+        return m_src[at_end() ? m_src.size() - 1 : m_pos];
     }
-    void m_advance(std::size_t x = 1) {
-        if (!at_end())
-            m_pos += x;
-        else
-            return;
+    void m_advance() {
+        if (!at_end()) ++m_pos;
     }
     [[noreturn]] void m_error(const std::string& msg) {
-        throw skai::exception{fmt::format("in {}, line: {}, column:{}.\nerror: {}", m_get().loc.file, m_get().loc.line,
-                                          m_get().loc.column, msg)};
+        auto at = m_src.empty() ? line_column{1, 1} : m_file.locate(m_get().loc.offset);
+        throw skai::exception{fmt::format("in {}, line: {}, column:{}.\nerror: {}", m_file.name, at.line, at.column, msg)};
+    }
+    std::string_view m_text(const token_handler& tok) const {
+        return tok.text(m_file);
+    }
+    const token_handler& m_previous() const {
+        return m_src[m_pos == 0 ? 0 : m_pos - 1];
+    }
+    std::int64_t m_number(std::string_view digits) {
+        std::int64_t value{};
+        auto res = std::from_chars(digits.data(), digits.data() + digits.size(), value);
+        if (res.ec != std::errc{}) m_error(fmt::format("invalid integer literal {}", digits));
+        return value;
+    }
+    double m_double(std::string_view digits) {
+        double value{};
+        auto res = std::from_chars(digits.data(), digits.data() + digits.size(), value);
+        if (res.ec != std::errc{}) m_error(fmt::format("invalid floating point literal {}", digits));
+        return value;
+    }
+    // escapes are decoded here once, string objects hold the bytes they print
+    str_ref m_string(std::string_view raw) {
+        if (raw.find('\\') == std::string_view::npos) return m_ast.intern(raw);
+        m_scratch.clear();
+        for (std::size_t i = 0; i < raw.size(); ++i) {
+            if (raw[i] != '\\') {
+                m_scratch.push_back(raw[i]);
+                continue;
+            }
+            switch (char c = raw[++i]) {
+                default:
+                    m_error(fmt::format("invalid escape character '{}'", c));
+                case 'n':
+                    m_scratch.push_back('\n');
+                    break;
+                case 't':
+                    m_scratch.push_back('\t');
+                    break;
+                case 'r':
+                    m_scratch.push_back('\r');
+                    break;
+                case '\\':
+                    m_scratch.push_back('\\');
+                    break;
+                case '"':
+                    m_scratch.push_back('"');
+                    break;
+                case 'b':
+                    m_scratch.push_back('\b');
+                    break;
+                case 'v':
+                    m_scratch.push_back('\v');
+                    break;
+                case 'f':
+                    m_scratch.push_back('\f');
+                    break;
+                case '0':
+                    m_scratch.push_back('\0');
+                    break;
+                case '$':
+                    m_scratch.push_back('$');
+                    break;
+            }
+        }
+        return m_ast.intern(m_scratch);
     }
-    auto m_peek(std::size_t x = 1) {
-        return m_src.at(m_pos + x);
+    // "a${x}b" comes as string_part(a), the tokens of x, string(b), the first part has been matched
+    node_ref m_interpolation() {
+        auto first = m_pending.size();
+        while (true) {
+            auto text = m_string(m_text(m_previous()));
+            if (!m_ast.str(text).empty()) m_pending.push_back(m_ast.make<string_expr>(text));
+            if (m_previous().tok == token::string) break;
+            m_pending.push_back(expression());
+            if (!m_match(token::string_part, token::string)) m_error("expected '}' after interpolated expression");
+        }
+        return m_ast.make<interpolation_expr>(m_list(first));
     }
-    auto m_previous(std::size_t x = 1) {
-        return m_src.at(m_src.size() == 0 ? 0 : m_pos - x);
+    // moves the elements pushed since 'first' into the ast
+    list_ref m_list(std::size_t first) {
+        auto l = m_ast.list(m_pending.data() + first, m_pending.size() - first);
+        m_pending.resize(first);
+        return l;
     }
-    bool at_end() {
+    bool at_end() const {
         return m_pos >= m_src.size();
     }
     template <class... T>
     bool m_match(T... toks) {
-        if (m_get().is(toks...) && !at_end()) {
+        if (!at_end() && m_get().is(toks...)) {
             m_advance();
             return true;
         }
         return false;
     }
 
-    auto consume(token tok, const std::string& msg) {
+    const token_handler& consume(token tok, const std::string& msg) {
         if (m_match(tok)) { return m_previous(); }
         m_error(msg);
     }
 
-    auto expression() {
-        return assignment();
-    }
-
-    std::shared_ptr<expr> assignment() {
-        auto expr_ = or_expr();
-        if (m_match(token::eq)) {
-            auto val = assignment();
-            expr_ = std::make_shared<assign_expr>((expr_), (val));
+    // binding power of the binary operators, from assignment (loosest) to multiplication, 0 ends an expression
+    enum precedence : int {
+        none,
+        assignment,
+        or_,
+        and_,
+        equality,
+        comparison,
+        range,
+        b_or,
+        xor_,
+        b_and,
+        shift,
+        term,
+        factor,
+    };
+    static int m_precedence(token tok) {
+        switch (tok) {
+            case token::eq:
+            case token::plus_eq:
+            case token::minus_eq:
+            case token::star_eq:
+            case token::slash_eq:
+            case token::mod_eq:
+            case token::xor_eq_:
+            case token::b_or_eq:
+            case token::b_and_eq:
+            case token::lshift_eq:
+            case token::rshift_eq:
+                return precedence::assignment;
+            case token::or_:
+                return precedence::or_;
+            case token::and_:
+                return precedence::and_;
+            case token::d_eq:
+            case token::not_eq_:
+                return precedence::equality;
+            case token::lt:
+            case token::lt_eq:
+            case token::gt:
+            case token::gt_eq:
+                return precedence::comparison;
+            case token::range:
+                return precedence::range;
+            case token::b_or:
+                return precedence::b_or;
+            case token::xor_:
+                return precedence::xor_;
+            case token::b_and:
+                return precedence::b_and;
+            case token::lshift:
+            case token::rshift:
+                return precedence::shift;
+            case token::plus:
+            case token::minus:
+                return precedence::term;
+            case token::star:
+            case token::slash:
+            case token::mod:
+                return precedence::factor;
         }
-        return expr_;
+        return precedence::none;
     }
-    std::shared_ptr<expr> equality() {
-        std::shared_ptr<expr> expr_ = comparison();
-        while (m_match(token::not_eq_, token::d_eq)) {
-            auto oper = m_previous();
-            std::shared_ptr<expr> right = comparison();
-            expr_ = std::make_shared<binary_expr>((expr_), oper.tok, (right));
+
+    node_ref expression(int min_prec = precedence::assignment) {
+        auto lhs = unary();
+        while (!at_end()) {
+            auto op = m_get().tok;
+            int prec = m_precedence(op);
+            if (prec == precedence::none || prec < min_prec) break;
+            m_advance();
+            if (prec == precedence::assignment) {
+                // right associative, 'a = b = c' assigns c to b first
+                auto rhs = expression(prec);
+                lhs = op == token::eq ? m_ast.make<assign_expr>(lhs, rhs) : m_ast.make<binary_expr>(op, lhs, rhs);
+            } else if (prec == precedence::or_ || prec == precedence::and_) {
+                lhs = m_ast.make<logical_expr>(op, lhs, expression(prec + 1));
+            } else if (prec == precedence::range) {
+                auto end = expression(prec + 1);
+                node_ref step = m_match(token::range) ? expression(prec + 1) : 0;
+                lhs = m_ast.make<range_expr>(lhs, end, step);
+            } else {
+                lhs = m_ast.make<binary_expr>(op, lhs, expression(prec + 1));
+            }
         }
-        return expr_;
+        return lhs;
     }
 
-    std::shared_ptr<expr> declaration() {
+    node_ref declaration() {
         if (m_match(token::let)) {
             return var_declaration();
         } else if (m_match(token::fun)) {
@@ -80,11 +225,11 @@ struct parser {
         return statement();
     }
 
-    std::shared_ptr<expr> statement() {
+    node_ref statement() {
         if (m_match(token::if_)) {
             return if_stmt_();
         } else if (m_match(token::lbracket)) {
-            return std::make_shared<block_stmt>(block_stmt{block()});
+            return m_ast.make<block_stmt>(block());
         } else if (m_match(token::while_)) {
             return while_stmt_();
         } else if (m_match(token::return_)) {
@@ -95,220 +240,216 @@ struct parser {
         return expr_stmt();
     }
 
-    std::shared_ptr<argument_expr> parse_arg() {
+    node_ref parse_arg() {
         auto ident = consume(token::identifier, "expected identifier in function argument");
-        std::shared_ptr<expr> def = nullptr;
+        node_ref def = 0;
         if (m_match(token::eq)) { def = expression(); }
-        return std::make_shared<argument_expr>(ident.str, def);
+        return m_ast.make<argument_expr>(m_ast.intern(m_text(ident)), def);
+    }
+
+    // 'lm x, y -> expr', the parameters are those of a function
+    node_ref lambda() {
+        auto params = m_pending.size();
+        if (m_get().isnot(token::arrow)) do {
+                if (m_pending.size() - params >= 255) m_error("can't have more than 255 parameters");
+                m_pending.push_back(parse_arg());
+            } while (m_match(token::comma));
+        consume(token::arrow, "expected '->' after lambda parameters");
+        auto args = m_list(params);
+        auto value = expression();
+        auto body = m_pending.size();
+        m_pending.push_back(m_ast.make<return_stmt>(value));
+        auto fn = m_ast.make<function_stmt>(m_ast.intern("lambda"), args, m_list(body));
+        return m_ast.make<lambda_expr>(fn);
+    }
+
+    // 'for x of iterable body', the variable has been matched
+    node_ref iterate_stmt_() {
+        auto name = m_ast.intern(m_text(m_previous()));
+        consume(token::of, "expected 'of' after for loop variable");
+        auto iterable = expression();
+        auto body = statement();
+        return m_ast.make<iterate_stmt>(name, iterable, body);
     }
 
-    std::shared_ptr<expr> return_stmt_() {
-        std::shared_ptr<expr> value = nullptr;
+    node_ref return_stmt_() {
+        node_ref value = 0;
         if (!m_get().is(token::scolon)) value = expression();
         consume(token::scolon, "expected ';' after return  expression");
-        return std::make_shared<return_stmt>(return_stmt{(value)});
+        return m_ast.make<return_stmt>(value);
     }
 
-    std::shared_ptr<expr> while_stmt_() {
-        std::shared_ptr<expr> init = nullptr;
+    node_ref while_stmt_() {
+        node_ref init = 0;
         if (m_match(token::let)) init = var_declaration();
         auto expr_ = expression();
-        return std::make_shared<while_stmt>(init, expr_, statement());
+        auto body = statement();
+        return m_ast.make<while_stmt>(init, expr_, body);
     }
 
-    std::shared_ptr<expr> for_stmt_() {
+    node_ref for_stmt_() {
+        if (m_match(token::identifier)) return iterate_stmt_();
         consume(token::let, "expected variable in for loop initializer");
         auto init = var_declaration();
         auto condition = expression();
         consume(token::scolon, "expected ';' after for loop condition");
         auto branch = expression();
         auto body = statement();
-        return std::make_shared<for_stmt>(init, condition, branch, body);
+        return m_ast.make<for_stmt>(init, condition, branch, body);
     }
 
-    std::shared_ptr<expr> expr_stmt() {
+    node_ref expr_stmt() {
         auto expr_ = expression();
         consume(token::scolon, "expected ';' after epxression");
         return expr_;
     }
 
-    std::shared_ptr<expr> or_expr() {
-        auto expr_ = and_expr();
-        while (m_match(token::or_)) {
-            auto oper = m_previous();
-            auto right = and_expr();
-            expr_ = std::make_shared<logical_expr>((expr_), oper.tok, (right));
-        }
-        return expr_;
-    }
-    std::shared_ptr<expr> and_expr() {
-        auto expr_ = equality();
-        while (m_match(token::and_)) {
-            auto oper = m_previous();
-            auto right = equality();
-            expr_ = std::make_shared<logical_expr>((expr_), oper.tok, (right));
-        }
-        return expr_;
-    }
-    std::shared_ptr<expr> var_declaration() {
+    node_ref var_declaration() {
         bool is_const = false;
-        std::shared_ptr<expr> init = nullptr;
+        node_ref init = 0;
         if (m_match(token::imm)) is_const = true;
         auto name = consume(token::identifier, "expected identifier for variable name");
         if (m_match(token::eq)) { init = expression(); }
         consume(token::scolon, "expected ';' after variable declaration");
-        return std::make_shared<variable_expr>(name.str, init, is_const);
+        return m_ast.make<variable_expr>(m_ast.intern(m_text(name)), init, is_const);
     }
 
-    std::shared_ptr<expr> if_stmt_() {
-        std::shared_ptr<expr> init = nullptr;
+    node_ref if_stmt_() {
+        node_ref init = 0;
         if (m_match(token::let)) init = var_declaration();
-        std::shared_ptr<expr> cond = expression();
-        std::shared_ptr<expr> then = statement();
-        std::shared_ptr<expr> else_ = nullptr;
+        node_ref cond = expression();
+        node_ref then = statement();
+        node_ref else_ = 0;
         if (m_match(token::else_)) { else_ = statement(); }
-        return std::make_shared<if_stmt>(init, cond, then, else_);
+        return m_ast.make<if_stmt>(init, cond, then, else_);
     }
 
-    std::shared_ptr<expr> function_stmt_() {
+    node_ref function_stmt_() {
         auto name = consume(token::identifier, "expected identifier");
-        std::vector<std::shared_ptr<argument_expr>> params;
+        auto params = m_pending.size();
         consume(token::lparen, "expected '(' after function");
         if (!m_get().is(token::rparen)) {
             do {
-                if (params.size() > 255) throw skai::exception{"can't have more than 255 parameters"};
-                params.push_back(parse_arg());
+                if (m_pending.size() - params >= 255) m_error("can't have more than 255 parameters");
+                m_pending.push_back(parse_arg());
             } while (m_match(token::comma));
         }
         consume(token::rparen, "expected ')' after argument list");
         consume(token::lbracket, "expected '{' after argument list");
-        return std::make_shared<function_stmt>(name.str, params, block());
+        auto args = m_list(params);
+        auto body = block();
+        return m_ast.make<function_stmt>(m_ast.intern(m_text(name)), args, body);
     }
 
-    std::shared_ptr<expr> class_decl() {
+    node_ref class_decl() {
         auto name = consume(token::identifier, "expected class name");
         consume(token::lbracket, "expected '{' after class declaration");
-        return std::make_shared<class_expr>(name.str, block());
+        auto members = block();
+        return m_ast.make<class_expr>(m_ast.intern(m_text(name)), members);
     }
-    std::vector<std::shared_ptr<expr>> block() {
-        std::vector<std::shared_ptr<expr>> stmts;
-        while (m_get().isnot(token::rbracket) && !at_end()) { stmts.emplace_back(declaration()); }
+    list_ref block() {
+        auto stmts = m_pending.size();
+        while (m_get().isnot(token::rbracket) && !at_end()) { m_pending.push_back(declaration()); }
         consume(token::rbracket, "expectd '}' after block statement");
-        return stmts;
-    }
-
-    std::shared_ptr<expr> comparison() {
-        auto expr_ = term();
-        while (m_match(token::lt, token::lt_eq, token::gt, token::gt_eq)) {
-            auto oper = m_previous();
-            auto right = term();
-            expr_ = std::make_shared<binary_expr>((expr_), oper.tok, (right));
-        }
-        return expr_;
+        return m_list(stmts);
     }
 
-    std::shared_ptr<expr> term() {
-        auto expr_ = factor();
-        while (m_match(token::plus, token::minus, token::plus_eq, token::minus_eq, token::dot)) {
-            if (m_previous().tok == token::dot) {
-                auto val = unary();
-                expr_ = std::make_shared<access_expr>((expr_), (val));
-            } else {
-                auto oper = m_previous();
-                auto right = factor();
-                expr_ = std::make_shared<binary_expr>((expr_), oper.tok, (right));
-            }
-        }
-        return expr_;
-    }
-    std::shared_ptr<expr> factor() {
-        auto expr_ = unary();
-        while (m_match(token::b_and, token::b_and_eq, token::b_or, token::b_or_eq, token::xor_eq_, token::xor_,
-                       token::slash, token::slash_eq, token::star, token::star_eq, token::mod, token::mod_eq)) {
-            auto oper = m_previous();
-            auto right = unary();
-            expr_ = std::make_shared<binary_expr>((expr_), oper.tok, (right));
-        }
-        return expr_;
-    }
-    std::shared_ptr<expr> unary() {
+    node_ref unary() {
         if (m_match(token::not_, token::minus, token::plus)) {
-            auto oper = m_previous();
-            return std::make_shared<unary_expr>(oper.tok, unary());
+            auto op = m_previous().tok;
+            auto operand = unary();
+            return m_ast.make<unary_expr>(op, operand);
         }
-        return subscript();
-    }
-    std::shared_ptr<expr> subscript() {
-        auto expr_ = call();
-        while (m_match(token::lcbracket)) {
-            auto idx = expression();
-            consume(token::rcbracket, "expected ']' after subscript expression");
-            expr_ = std::make_shared<subscript_expr>(expr_, idx);
-        }
-        return expr_;
+        return postfix(primary());
     }
 
-    std::shared_ptr<expr> call() {
-        auto expr_ = access();
-        std::vector<std::shared_ptr<expr>> args;
+    // calls, subscripts and member accesses bind tighter than any operator and chain in any order
+    node_ref postfix(node_ref expr_) {
         while (true) {
             if (m_match(token::lparen)) {
+                auto args = m_pending.size();
                 if (m_get().isnot(token::rparen)) {
                     do {
-                        if (args.size() > 255) m_error("can't have more than 255 arguments");
-                        args.push_back(expression());
+                        if (m_pending.size() - args >= 255) m_error("can't have more than 255 arguments");
+                        m_pending.push_back(expression());
                     } while (m_match(token::comma));
                 }
                 consume(token::rparen, "expected ')' after argument list");
-                expr_ = std::make_shared<call_expr>((expr_), (args));
+                expr_ = m_ast.make<call_expr>(expr_, m_list(args));
+            } else if (m_match(token::lcbracket)) {
+                node_ref idx = m_get().is(token::colon) ? 0 : expression();
+                if (m_match(token::colon)) {
+                    node_ref end = m_get().is(token::rcbracket) ? 0 : expression();
+                    consume(token::rcbracket, "expected ']' after slice expression");
+                    expr_ = m_ast.make<slice_expr>(expr_, idx, end);
+                } else {
+                    consume(token::rcbracket, "expected ']' after subscript expression");
+                    expr_ = m_ast.make<subscript_expr>(expr_, idx);
+                }
+            } else if (m_match(token::dot)) {
+                auto& name = consume(token::identifier, "expected member name after '.'");
+                expr_ = m_ast.make<access_expr>(expr_, m_ast.make<ident_expr>(m_ast.intern(m_text(name))));
             } else {
-                break;
+                return expr_;
             }
         }
-        return expr_;
-    }
-    std::shared_ptr<expr> access() {
-        auto expr_ = primary();
-        while (m_match(token::dot)) { expr_ = std::make_shared<access_expr>(expr_, primary()); }
-        return expr_;
     }
 
-    std::shared_ptr<expr> primary() {
-        if (m_match(token::true_, token::false_)) { return std::make_shared<bool_expr>(m_previous().tok); }
-        if (m_match(token::break_)) { return std::make_shared<break_stmt>(); }
-        if (m_match(token::continue_)) { return std::make_shared<continue_stmt>(); }
-        if (m_match(token::null)) { return std::make_shared<null_expr>(); }
-        if (m_match(token::self)) { return std::make_shared<self_expr>(); }
-        if (m_match(token::number)) { return std::make_shared<num_expr>(m_previous().str); }
-        if (m_match(token::double_)) { return std::make_shared<ldouble_expr>(m_previous().str); }
-        if (m_match(token::string)) { return std::make_shared<string_expr>(m_previous().str); }
+    node_ref primary() {
+        if (m_match(token::true_, token::false_)) { return m_ast.make<bool_expr>(m_previous().tok == token::true_); }
+        if (m_match(token::break_)) { return m_ast.make<break_stmt>(); }
+        if (m_match(token::continue_)) { return m_ast.make<continue_stmt>(); }
+        if (m_match(token::null)) { return m_ast.make<null_expr>(); }
+        if (m_match(token::self)) { return m_ast.make<self_expr>(); }
+        if (m_match(token::number)) { return m_ast.make<num_expr>(m_number(m_text(m_previous()))); }
+        if (m_match(token::double_)) { return m_ast.make<ldouble_expr>(m_double(m_text(m_previous()))); }
+        if (m_match(token::string)) { return m_ast.make<string_expr>(m_string(m_text(m_previous()))); }
+        if (m_match(token::string_part)) { return m_interpolation(); }
         if (m_match(token::lparen)) {
             auto expr_ = expression();
             if (!m_match(token::rparen)) { m_error("expected ')' after expression"); }
             return expr_;
         }
-        if (m_match(token::identifier)) { return std::make_shared<ident_expr>(m_previous().str); }
+        if (m_match(token::identifier)) { return m_ast.make<ident_expr>(m_ast.intern(m_text(m_previous()))); }
+        if (m_match(token::lm)) { return lambda(); }
         if (m_match(token::lcbracket)) {
-            std::vector<std::shared_ptr<expr>> vals;
+            auto vals = m_pending.size();
             if (m_get().isnot(token::rcbracket)) do {
-                    vals.push_back(expression());
+                    m_pending.push_back(expression());
                 } while (m_match(token::comma));
             consume(token::rcbracket, "expected ']' after array declaration");
-            return std::make_shared<array_expr>(vals);
+            return m_ast.make<array_expr>(m_list(vals));
+        }
+        // a '{' starting a statement is a block, anywhere else it's a dict
+        if (m_match(token::lbracket)) {
+            auto entries = m_pending.size();
+            if (m_get().isnot(token::rbracket)) do {
+                    m_pending.push_back(expression());
+                    consume(token::colon, "expected ':' after dict key");
+                    m_pending.push_back(expression());
+                } while (m_match(token::comma));
+            consume(token::rbracket, "expected '}' after dict declaration");
+            return m_ast.make<dict_expr>(m_list(entries));
         }
-        m_error(fmt::format("unexpected token {}", m_get().str));
+        m_error(fmt::format("unexpected token {}", m_text(m_get())));
     }
 
     std::vector<token_handler> m_src;
-    std::string m_file;
+    const source_file& m_file;
     std::size_t m_pos = 0;
     std::size_t line = 1;
+    ast m_ast;
+    // elements of the lists being parsed, nested lists are stacked on top of their parent's elements
+    std::vector<node_ref> m_pending;
+    // buffer for string literals with escapes, the interned copy is kept
+    std::string m_scratch;
 
    public:
-    auto parse() {
-        std::vector<std::shared_ptr<expr>> stmts;
-        while (!at_end()) stmts.emplace_back(declaration());
-        return stmts;
+    // the parser hands its arena over, it can only be used once
+    ast parse() {
+        while (!at_end()) m_pending.push_back(declaration());
+        m_ast.program = m_list(0);
+        return std::move(m_ast);
     }
 };
 }  // namespace skai
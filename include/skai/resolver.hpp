@@ -0,0 +1,276 @@
+#ifndef SKAI_RESOLVER_HPP_5820EIOE39PE
+#define SKAI_RESOLVER_HPP_5820EIOE39PE
+#include <fmt/format.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ast.hpp"
+#include "error.hpp"
+#include "object.hpp"
+#include "scope.hpp"
+
+namespace skai {
+// runs between the parser and the tree walking interpreter, binds every name to a slot so that the interpreter never
+// looks a variable up by its name. declarations at the top level of the script are globals, every other declaration
+// gets its own slot in the frame of the enclosing function (or of the script). a function only captures the variables
+// it references, through upvalues
+struct resolver {
+    resolver(global_table<object::value>& globals) : m_globals{globals} {}
+
+    // returns the script wrapped into a function so that its frame is described like any other
+    node_ref resolve(ast& tree) {
+        m_ast = &tree;
+        auto script = tree.make<function_stmt>(tree.intern("script"), list_ref{}, tree.program);
+        m_functions.clear();
+        m_functions.push_back(function_scope{});
+        for (auto stmt : tree.nodes(tree.program)) m_resolve(stmt);
+        tree.get<function_stmt>(script).slots = m_functions.back().slots;
+        m_functions.clear();
+        return script;
+    }
+
+   private:
+    struct local {
+        std::uint32_t slot;
+        bool is_const;
+        bool captured = false;
+        // bindings already handed out, they have to be boxed once a nested function captures the local
+        std::vector<binding*> uses{};
+    };
+    struct function_scope {
+        std::vector<std::unordered_map<str_ref, local>> blocks{1};
+        std::vector<capture> captures{};
+        std::uint32_t slots = 0;
+    };
+
+    void m_begin_block() {
+        m_functions.back().blocks.emplace_back();
+    }
+    void m_end_block() {
+        m_functions.back().blocks.pop_back();
+    }
+
+    void m_declare(str_ref name, bool is_const, binding& bind) {
+        auto& fn = m_functions.back();
+        if (m_functions.size() == 1 && fn.blocks.size() == 1) {
+            bind = binding{binding::storage::global, m_globals.index_of(m_ast->str(name))};
+            return;
+        }
+        // slots are never reused, a closure may still reference a variable after its block ended
+        bind = binding{binding::storage::local, fn.slots++};
+        fn.blocks.back()[name] = local{bind.slot, is_const, false, {&bind}};
+    }
+
+    void m_bind(str_ref name, bool is_assignment, binding& bind) {
+        for (auto fn = m_functions.size(); fn-- > 0;) {
+            auto& blocks = m_functions[fn].blocks;
+            for (auto it = blocks.rbegin(); it != blocks.rend(); ++it) {
+                auto loc = it->find(name);
+                if (loc == it->end()) continue;
+                auto& var = loc->second;
+                if (is_assignment && var.is_const)
+                    throw skai::exception{fmt::format("assigning to const variable '{}'", m_ast->str(name))};
+                if (fn == m_functions.size() - 1) {
+                    bind = binding{var.captured ? binding::storage::cell : binding::storage::local, var.slot};
+                    var.uses.push_back(&bind);
+                    return;
+                }
+                if (!var.captured) {
+                    var.captured = true;
+                    for (auto use : var.uses) use->where = binding::storage::cell;
+                }
+                bind = binding{binding::storage::upvalue, m_upvalue(m_functions.size() - 1, fn, var.slot)};
+                return;
+            }
+        }
+        bind = binding{binding::storage::global, m_globals.index_of(m_ast->str(name))};
+    }
+
+    // index of the upvalue through which function 'fn' reaches 'slot' of the enclosing function 'owner', every
+    // function in between gets an upvalue as well
+    std::uint32_t m_upvalue(std::size_t fn, std::size_t owner, std::uint32_t slot) {
+        auto cap = fn - 1 == owner ? capture{true, slot} : capture{false, m_upvalue(fn - 1, owner, slot)};
+        auto& captures = m_functions[fn].captures;
+        for (std::size_t i = 0; i < captures.size(); ++i)
+            if (captures[i].is_local == cap.is_local && captures[i].index == cap.index)
+                return static_cast<std::uint32_t>(i);
+        captures.push_back(cap);
+        return static_cast<std::uint32_t>(captures.size() - 1);
+    }
+
+    void m_resolve(list_ref l) {
+        for (auto ref : m_ast->nodes(l)) m_resolve(ref);
+    }
+
+    void m_resolve(node_ref ref) {
+        auto& tree = *m_ast;
+        switch (tree.kind(ref)) {
+            case node_kind::ident: {
+                auto& n = tree.get<ident_expr>(ref);
+                m_bind(n.name, false, n.bind);
+                break;
+            }
+            case node_kind::variable: {
+                auto& n = tree.get<variable_expr>(ref);
+                m_resolve(n.value);
+                m_declare(n.name, n.is_const, n.bind);
+                break;
+            }
+            case node_kind::assign: {
+                auto& n = tree.get<assign_expr>(ref);
+                if (tree.kind(n.lhs) == node_kind::subscript) {
+                    m_resolve(n.lhs);
+                    m_resolve(n.rhs);
+                    break;
+                }
+                if (tree.kind(n.lhs) != node_kind::ident) throw skai::exception{"invalid operand for '='"};
+                m_resolve(n.rhs);
+                auto& ident = tree.get<ident_expr>(n.lhs);
+                m_bind(ident.name, true, n.bind);
+                break;
+            }
+            case node_kind::binary: {
+                auto& n = tree.get<binary_expr>(ref);
+                if (compound_base(n.op) != n.op) {
+                    if (tree.kind(n.lhs) != node_kind::ident)
+                        throw skai::exception{"invalid operand for compound assignment"};
+                    auto& ident = tree.get<ident_expr>(n.lhs);
+                    m_bind(ident.name, true, ident.bind);
+                } else {
+                    m_resolve(n.lhs);
+                }
+                m_resolve(n.rhs);
+                break;
+            }
+            case node_kind::logical: {
+                auto& n = tree.get<logical_expr>(ref);
+                m_resolve(n.lhs);
+                m_resolve(n.rhs);
+                break;
+            }
+            case node_kind::unary:
+                m_resolve(tree.get<unary_expr>(ref).operand);
+                break;
+            case node_kind::call: {
+                auto& n = tree.get<call_expr>(ref);
+                m_resolve(n.callee);
+                m_resolve(n.arguments);
+                break;
+            }
+            case node_kind::function:
+                m_visit_func(tree.get<function_stmt>(ref));
+                break;
+            case node_kind::lambda:
+                m_function(tree.get<function_stmt>(tree.get<lambda_expr>(ref).function));
+                break;
+            case node_kind::return_:
+                m_resolve(tree.get<return_stmt>(ref).value);
+                break;
+            case node_kind::iterate: {
+                auto& n = tree.get<iterate_stmt>(ref);
+                m_begin_block();
+                m_resolve(n.iterable);
+                m_declare(n.name, false, n.bind);
+                m_resolve(n.body);
+                m_end_block();
+                break;
+            }
+            case node_kind::block:
+                m_begin_block();
+                m_resolve(tree.get<block_stmt>(ref).stmts);
+                m_end_block();
+                break;
+            case node_kind::if_: {
+                auto& n = tree.get<if_stmt>(ref);
+                m_begin_block();
+                m_resolve(n.init);
+                m_resolve(n.condition);
+                m_resolve(n.then_branch);
+                m_resolve(n.else_branch);
+                m_end_block();
+                break;
+            }
+            case node_kind::while_: {
+                auto& n = tree.get<while_stmt>(ref);
+                m_begin_block();
+                m_resolve(n.init);
+                m_resolve(n.branch);
+                m_resolve(n.body);
+                m_end_block();
+                break;
+            }
+            case node_kind::for_: {
+                auto& n = tree.get<for_stmt>(ref);
+                m_begin_block();
+                m_resolve(n.init);
+                m_resolve(n.condition);
+                m_resolve(n.branch);
+                m_resolve(n.body);
+                m_end_block();
+                break;
+            }
+            case node_kind::array:
+                m_resolve(tree.get<array_expr>(ref).elements);
+                break;
+            case node_kind::interpolation:
+                m_resolve(tree.get<interpolation_expr>(ref).parts);
+                break;
+            case node_kind::dict:
+                m_resolve(tree.get<dict_expr>(ref).entries);
+                break;
+            case node_kind::subscript: {
+                auto& n = tree.get<subscript_expr>(ref);
+                m_resolve(n.object);
+                m_resolve(n.target);
+                break;
+            }
+            case node_kind::slice: {
+                auto& n = tree.get<slice_expr>(ref);
+                m_resolve(n.object);
+                m_resolve(n.begin);
+                m_resolve(n.end);
+                break;
+            }
+            case node_kind::access:
+                m_resolve(tree.get<access_expr>(ref).target);
+                break;
+            case node_kind::range: {
+                auto& n = tree.get<range_expr>(ref);
+                m_resolve(n.begin);
+                m_resolve(n.end);
+                m_resolve(n.step);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    void m_visit_func(function_stmt& ftst) {
+        // declared before the body so that the function can call itself
+        m_declare(ftst.name, false, ftst.bind);
+        m_function(ftst);
+    }
+    // a lambda only has this part, it has no name to declare
+    void m_function(function_stmt& ftst) {
+        m_functions.push_back(function_scope{});
+        for (auto arg : m_ast->nodes(ftst.arguments)) {
+            auto& n = m_ast->get<argument_expr>(arg);
+            m_declare(n.name, false, n.bind);
+        }
+        for (auto arg : m_ast->nodes(ftst.arguments)) m_resolve(m_ast->get<argument_expr>(arg).def);
+        m_resolve(ftst.body);
+        ftst.slots = m_functions.back().slots;
+        ftst.captures = m_ast->add_captures(m_functions.back().captures);
+        m_functions.pop_back();
+    }
+
+    ast* m_ast{};
+    global_table<object::value>& m_globals;
+    std::vector<function_scope> m_functions;
+};
+}  // namespace skai
+#endif
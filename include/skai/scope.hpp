@@ -1,76 +1,54 @@
 #ifndef SKAI_SCOPE_HPP_749393IEOEPEPE
 #define SKAI_SCOPE_HPP_749393IEOEPEPE
-#include <map>
-#include <memory>
+#include <fmt/format.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "error.hpp"
 namespace skai {
+// globals are resolved to indices ahead of time, the table is shared between the resolver (or compiler) and the
+// backend so that every compilation unit sees the same slots
 template <class ObjectClass>
-struct scope {
-    scope(const std::map<std::string, std::shared_ptr<ObjectClass>>& m = {}) : contents{m} {}
-
-    scope(const scope<ObjectClass>& enc) : contents{}, enclosing{std::make_shared<scope<ObjectClass>>(enc.contents)} {}
-
-    scope& operator=(const scope& other) {
-        contents = other.contents;
-        return *this;
+struct global_table {
+    std::vector<std::string> names;
+    std::vector<ObjectClass> values;
+    std::vector<bool> is_const;
+
+    std::uint16_t index_of(const std::string& name) {
+        if (auto it = m_index.find(name); it != m_index.end()) return it->second;
+        if (names.size() >= UINT16_MAX) throw skai::exception{"too many global variables"};
+        names.push_back(name);
+        values.push_back(ObjectClass::undefined());
+        is_const.push_back(false);
+        return m_index[name] = static_cast<std::uint16_t>(names.size() - 1);
     }
 
-    void define(const std::string& name, const std::shared_ptr<ObjectClass>& obj) {
-        /*if (auto it = contents.find(name); it != contents.end()) {
-            throw skai::exception{fmt::format("redefinition of '{}'", name)};
-        }*/
-        contents[name] = obj;
+    void define(const std::string& name, const ObjectClass& obj) {
+        values.at(index_of(name)) = obj;
     }
 
-    const auto& get_contents() const { return contents; }
-    void set_contents(const std::map<std::string, std::shared_ptr<ObjectClass>>& cn) { contents = cn; }
-
-    auto accessor(std::size_t depth) {
-        auto env = *this;
-        for (; depth >= 0; --depth) env = env.enclosing;
-        return env;
+    ObjectClass& get(std::uint16_t idx) {
+        auto& obj = values[idx];
+        if (obj.is_undefined()) throw skai::exception{fmt::format("use of undeclared identifier {}.", names[idx])};
+        return obj;
     }
 
-    void assign(const std::string& name, const std::shared_ptr<ObjectClass>& obj) {
-        if (auto it = contents.find(name); it != contents.end()) {
-            contents[name] = obj;
-        } else if (enclosing) {
-            enclosing->assign(name, obj);
-        } else {
-            throw skai::exception{fmt::format("use of undeclared identifier {}.", name)};
-        }
-    }
-
-    auto get(const std::string& name) {
-        if (auto it = contents.find(name); it != contents.end()) {
-            return it->second;
-        } else if (enclosing) {
-            return enclosing->get(name);
-        }
-        throw skai::exception{fmt::format("use of undeclared identifier {}.", name)};
-    }
-    std::shared_ptr<ObjectClass> get_or_nullptr(const std::string& name) {
-        if (auto it = contents.find(name); it != contents.end()) {
-            return it->second;
-        } else if (enclosing) {
-            return enclosing->get(name);
-        }
-        return nullptr;
+    // the slot of a global that is about to be assigned
+    ObjectClass& target(std::uint16_t idx) {
+        auto& slot = get(idx);
+        if (is_const[idx]) throw skai::exception{fmt::format("assigning to const variable '{}'", names[idx])};
+        return slot;
     }
 
-    std::string to_string() const {
-        std::string cnt;
-        for (const auto& [key, value] : contents) {
-            cnt += fmt::format("{} | {}\n", key, value->to_string());
-        }
-        if (enclosing != nullptr) (cnt += " ->") += enclosing->to_string();
-        return cnt;
+    void assign(std::uint16_t idx, const ObjectClass& obj) {
+        target(idx) = obj;
     }
 
    private:
-    std::map<std::string, std::shared_ptr<ObjectClass>> contents;
-    std::shared_ptr<scope<ObjectClass>> enclosing;
+    std::unordered_map<std::string, std::uint16_t> m_index;
 };
 }  // namespace skai
 #endif
@@ -0,0 +1,256 @@
+#ifndef SKAI_SIMD_HPP_5A0C97E2D14F
+#define SKAI_SIMD_HPP_5A0C97E2D14F
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SKAI_SIMD_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SKAI_SIMD_SSE2 1
+#endif
+
+namespace skai {
+// kernels over the elements of typed arrays. the instruction set is picked when skai is compiled: avx2 if the build
+// targets it (-mavx2, -march=native), sse2 on any other x86-64 and plain loops everywhere else. every kernel finishes
+// the elements that don't fill a vector with the scalar loop, which is also the whole kernel without simd. an operand
+// flagged as scalar ('AScalar', 'BScalar') is a single value applied to every element
+namespace simd {
+enum class arith : std::uint8_t { add, sub, mul, div };
+
+template <arith Op>
+double apply(double a, double b) {
+    if constexpr (Op == arith::add) return a + b;
+    if constexpr (Op == arith::sub) return a - b;
+    if constexpr (Op == arith::mul) return a * b;
+    return a / b;
+}
+#if defined(SKAI_SIMD_AVX2)
+template <arith Op>
+__m256d apply(__m256d a, __m256d b) {
+    if constexpr (Op == arith::add) return _mm256_add_pd(a, b);
+    if constexpr (Op == arith::sub) return _mm256_sub_pd(a, b);
+    if constexpr (Op == arith::mul) return _mm256_mul_pd(a, b);
+    return _mm256_div_pd(a, b);
+}
+#elif defined(SKAI_SIMD_SSE2)
+template <arith Op>
+__m128d apply(__m128d a, __m128d b) {
+    if constexpr (Op == arith::add) return _mm_add_pd(a, b);
+    if constexpr (Op == arith::sub) return _mm_sub_pd(a, b);
+    if constexpr (Op == arith::mul) return _mm_mul_pd(a, b);
+    return _mm_div_pd(a, b);
+}
+#endif
+
+template <arith Op, bool AScalar, bool BScalar>
+void f64(const double* a, const double* b, double* out, std::size_t n) {
+    std::size_t i = 0;
+#if defined(SKAI_SIMD_AVX2)
+    for (; i + 4 <= n; i += 4) {
+        auto x = AScalar ? _mm256_set1_pd(*a) : _mm256_loadu_pd(a + i);
+        auto y = BScalar ? _mm256_set1_pd(*b) : _mm256_loadu_pd(b + i);
+        _mm256_storeu_pd(out + i, apply<Op>(x, y));
+    }
+#elif defined(SKAI_SIMD_SSE2)
+    for (; i + 2 <= n; i += 2) {
+        auto x = AScalar ? _mm_set1_pd(*a) : _mm_loadu_pd(a + i);
+        auto y = BScalar ? _mm_set1_pd(*b) : _mm_loadu_pd(b + i);
+        _mm_storeu_pd(out + i, apply<Op>(x, y));
+    }
+#endif
+    for (; i < n; ++i) out[i] = apply<Op>(a[AScalar ? 0 : i], b[BScalar ? 0 : i]);
+}
+
+// integer addition and subtraction, false if any element overflowed. the sums wrap and the sign bits tell whether they
+// did, so the vector loop has no branch
+template <bool Sub, bool AScalar, bool BScalar>
+bool i64(const std::int64_t* a, const std::int64_t* b, std::int64_t* out, std::size_t n) {
+    std::size_t i = 0;
+    std::uint64_t overflow = 0;
+#if defined(SKAI_SIMD_AVX2)
+    auto flags = _mm256_setzero_si256();
+    for (; i + 4 <= n; i += 4) {
+        auto x = AScalar ? _mm256_set1_epi64x(*a) : _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        auto y = BScalar ? _mm256_set1_epi64x(*b) : _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        auto r = Sub ? _mm256_sub_epi64(x, y) : _mm256_add_epi64(x, y);
+        auto bad = Sub ? _mm256_and_si256(_mm256_xor_si256(x, y), _mm256_xor_si256(x, r))
+                       : _mm256_and_si256(_mm256_xor_si256(x, r), _mm256_xor_si256(y, r));
+        flags = _mm256_or_si256(flags, bad);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), r);
+    }
+    overflow |= static_cast<std::uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(flags)));
+#elif defined(SKAI_SIMD_SSE2)
+    auto flags = _mm_setzero_si128();
+    for (; i + 2 <= n; i += 2) {
+        auto x = AScalar ? _mm_set1_epi64x(*a) : _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        auto y = BScalar ? _mm_set1_epi64x(*b) : _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        auto r = Sub ? _mm_sub_epi64(x, y) : _mm_add_epi64(x, y);
+        auto bad = Sub ? _mm_and_si128(_mm_xor_si128(x, y), _mm_xor_si128(x, r))
+                       : _mm_and_si128(_mm_xor_si128(x, r), _mm_xor_si128(y, r));
+        flags = _mm_or_si128(flags, bad);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), r);
+    }
+    overflow |= static_cast<std::uint64_t>(_mm_movemask_pd(_mm_castsi128_pd(flags)));
+#endif
+    for (; i < n; ++i) {
+        auto x = static_cast<std::uint64_t>(a[AScalar ? 0 : i]), y = static_cast<std::uint64_t>(b[BScalar ? 0 : i]);
+        auto r = Sub ? x - y : x + y;
+        overflow |= (Sub ? (x ^ y) & (x ^ r) : (x ^ r) & (y ^ r)) >> 63;
+        out[i] = static_cast<std::int64_t>(r);
+    }
+    return overflow == 0;
+}
+
+// the lanes add up separately, the result may differ from a left to right sum in the last bits
+inline double sum(const double* a, std::size_t n) {
+    std::size_t i = 0;
+    double total = 0;
+#if defined(SKAI_SIMD_AVX2)
+    auto acc = _mm256_setzero_pd();
+    for (; i + 4 <= n; i += 4) acc = _mm256_add_pd(acc, _mm256_loadu_pd(a + i));
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, acc);
+    total = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(SKAI_SIMD_SSE2)
+    auto acc = _mm_setzero_pd();
+    for (; i + 2 <= n; i += 2) acc = _mm_add_pd(acc, _mm_loadu_pd(a + i));
+    alignas(16) double lanes[2];
+    _mm_store_pd(lanes, acc);
+    total = lanes[0] + lanes[1];
+#endif
+    for (; i < n; ++i) total += a[i];
+    return total;
+}
+inline double dot(const double* a, const double* b, std::size_t n) {
+    std::size_t i = 0;
+    double total = 0;
+#if defined(SKAI_SIMD_AVX2)
+    auto acc = _mm256_setzero_pd();
+    for (; i + 4 <= n; i += 4)
+        acc = _mm256_add_pd(acc, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, acc);
+    total = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(SKAI_SIMD_SSE2)
+    auto acc = _mm_setzero_pd();
+    for (; i + 2 <= n; i += 2) acc = _mm_add_pd(acc, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    alignas(16) double lanes[2];
+    _mm_store_pd(lanes, acc);
+    total = lanes[0] + lanes[1];
+#endif
+    for (; i < n; ++i) total += a[i] * b[i];
+    return total;
+}
+// 'n' is at least 1
+template <bool Max>
+double extreme(const double* a, std::size_t n) {
+    std::size_t i = 1;
+    double best = a[0];
+#if defined(SKAI_SIMD_AVX2)
+    if (n >= 4) {
+        auto acc = _mm256_loadu_pd(a);
+        for (i = 4; i + 4 <= n; i += 4) {
+            auto x = _mm256_loadu_pd(a + i);
+            acc = Max ? _mm256_max_pd(acc, x) : _mm256_min_pd(acc, x);
+        }
+        alignas(32) double lanes[4];
+        _mm256_store_pd(lanes, acc);
+        best = lanes[0];
+        for (auto lane : lanes) best = Max ? (lane > best ? lane : best) : (lane < best ? lane : best);
+    }
+#elif defined(SKAI_SIMD_SSE2)
+    if (n >= 2) {
+        auto acc = _mm_loadu_pd(a);
+        for (i = 2; i + 2 <= n; i += 2) {
+            auto x = _mm_loadu_pd(a + i);
+            acc = Max ? _mm_max_pd(acc, x) : _mm_min_pd(acc, x);
+        }
+        alignas(16) double lanes[2];
+        _mm_store_pd(lanes, acc);
+        best = Max ? (lanes[1] > lanes[0] ? lanes[1] : lanes[0]) : (lanes[1] < lanes[0] ? lanes[1] : lanes[0]);
+    }
+#endif
+    for (; i < n; ++i) best = Max ? (a[i] > best ? a[i] : best) : (a[i] < best ? a[i] : best);
+    return best;
+}
+
+// false if the sum doesn't fit in 64 bits, whatever the order of the additions ([max, 1, -max] sums to 1). the lanes
+// wrap around and flag their own overflows, wrapping additions give the same total in any order so it's right whenever
+// no lane is flagged. otherwise the sum is redone counting how many times it wrapped in each direction
+inline bool sum(const std::int64_t* a, std::size_t n, std::int64_t& out) {
+    std::size_t i = 0;
+    std::uint64_t overflow = 0;
+    std::int64_t total = 0;
+    auto add = [&](std::int64_t x) {
+        auto r = static_cast<std::uint64_t>(total) + static_cast<std::uint64_t>(x);
+        overflow |= ((static_cast<std::uint64_t>(total) ^ r) & (static_cast<std::uint64_t>(x) ^ r)) >> 63;
+        total = static_cast<std::int64_t>(r);
+    };
+#if defined(SKAI_SIMD_AVX2)
+    auto acc = _mm256_setzero_si256(), flags = _mm256_setzero_si256();
+    for (; i + 4 <= n; i += 4) {
+        auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        auto r = _mm256_add_epi64(acc, x);
+        flags = _mm256_or_si256(flags, _mm256_and_si256(_mm256_xor_si256(acc, r), _mm256_xor_si256(x, r)));
+        acc = r;
+    }
+    overflow |= static_cast<std::uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(flags)));
+    alignas(32) std::int64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    for (auto lane : lanes) add(lane);
+#elif defined(SKAI_SIMD_SSE2)
+    auto acc = _mm_setzero_si128(), flags = _mm_setzero_si128();
+    for (; i + 2 <= n; i += 2) {
+        auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        auto r = _mm_add_epi64(acc, x);
+        flags = _mm_or_si128(flags, _mm_and_si128(_mm_xor_si128(acc, r), _mm_xor_si128(x, r)));
+        acc = r;
+    }
+    overflow |= static_cast<std::uint64_t>(_mm_movemask_pd(_mm_castsi128_pd(flags)));
+    alignas(16) std::int64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    for (auto lane : lanes) add(lane);
+#endif
+    for (; i < n; ++i) add(a[i]);
+    if (overflow == 0) {
+        out = total;
+        return true;
+    }
+    std::int64_t wraps = 0;
+    total = 0;
+    for (i = 0; i < n; ++i) {
+        overflow = 0;
+        add(a[i]);
+        if (overflow != 0) wraps += a[i] < 0 ? -1 : 1;
+    }
+    out = total;
+    return wraps == 0;
+}
+// 'n' is at least 1, sse2 has no 64 bit integer comparison and runs the scalar loop
+template <bool Max>
+std::int64_t extreme(const std::int64_t* a, std::size_t n) {
+    std::size_t i = 1;
+    std::int64_t best = a[0];
+#if defined(SKAI_SIMD_AVX2)
+    if (n >= 4) {
+        auto acc = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+        for (i = 4; i + 4 <= n; i += 4) {
+            auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            // takes 'x' where it's beyond the accumulated value
+            auto beyond = Max ? _mm256_cmpgt_epi64(x, acc) : _mm256_cmpgt_epi64(acc, x);
+            acc = _mm256_blendv_epi8(acc, x, beyond);
+        }
+        alignas(32) std::int64_t lanes[4];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+        best = lanes[0];
+        for (auto lane : lanes) best = Max ? (lane > best ? lane : best) : (lane < best ? lane : best);
+    }
+#endif
+    for (; i < n; ++i) best = Max ? (a[i] > best ? a[i] : best) : (a[i] < best ? a[i] : best);
+    return best;
+}
+}  // namespace simd
+}  // namespace skai
+#endif
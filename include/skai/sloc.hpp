@@ -1,12 +1,116 @@
 #ifndef SKAI_SLOC_HPP_7493030303
 #define SKAI_SLOC_HPP_7493030303
+#include <algorithm>
 #include <cstdint>
+#include <deque>
+#include <fstream>
+#include <iterator>
 #include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SKAI_HAS_MMAP 1
+#endif
+
 namespace skai {
+// a position in the source, the line and column are only computed when a diagnostic needs them
 struct source_location {
-    std::string file;
-    std::uint64_t line;
-    std::uint64_t column;
+    std::uint32_t file;
+    std::uint32_t offset;
+};
+
+struct line_column {
+    std::uint32_t line;
+    std::uint32_t column;
+};
+
+// the text of one script, files are mapped into memory and tokens point straight into the mapping
+struct source_file {
+    source_file(std::uint32_t id, std::string name, std::string text)
+        : id{id}, name{std::move(name)}, m_owned{std::move(text)}, m_text{m_owned}, m_ok{true} {}
+    // check 'ok()' before using a file opened from a path
+    source_file(std::uint32_t id, std::string path) : id{id}, name{std::move(path)} {
+#ifdef SKAI_HAS_MMAP
+        int fd = ::open(name.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st {};
+        if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            auto size = static_cast<std::size_t>(st.st_size);
+            void* addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED) {
+                m_map = addr;
+                m_map_size = size;
+                m_text = std::string_view{static_cast<const char*>(addr), size};
+                m_ok = true;
+            }
+        }
+        ::close(fd);
+        if (m_ok) return;
+#endif
+        // pipes and empty files can't be mapped, they are read instead
+        std::ifstream file{name, std::ios::binary};
+        if (!file) return;
+        m_owned.assign(std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{});
+        m_text = m_owned;
+        m_ok = true;
+    }
+    source_file(const source_file&) = delete;
+    source_file& operator=(const source_file&) = delete;
+    ~source_file() {
+#ifdef SKAI_HAS_MMAP
+        if (m_map) ::munmap(m_map, m_map_size);
+#endif
+    }
+
+    bool ok() const {
+        return m_ok;
+    }
+    std::string_view text() const {
+        return m_text;
+    }
+
+    // line and column (both starting at 1) of a byte offset, the line table is built on first use
+    line_column locate(std::uint32_t offset) const {
+        if (m_lines.empty()) {
+            m_lines.push_back(0);
+            for (std::size_t i = 0; i < m_text.size(); ++i)
+                if (m_text[i] == '\n') m_lines.push_back(static_cast<std::uint32_t>(i + 1));
+        }
+        auto line = std::upper_bound(m_lines.begin(), m_lines.end(), offset) - 1;
+        return {static_cast<std::uint32_t>(line - m_lines.begin() + 1), offset - *line + 1};
+    }
+
+    const std::uint32_t id;
+    const std::string name;
+
+   private:
+    std::string m_owned;
+    std::string_view m_text;
+    bool m_ok = false;
+    void* m_map = nullptr;
+    std::size_t m_map_size = 0;
+    mutable std::vector<std::uint32_t> m_lines;
+};
+
+// owns every source file of a run, a file id is its index
+struct sources {
+    const source_file& open(const std::string& path) {
+        return m_files.emplace_back(static_cast<std::uint32_t>(m_files.size()), path);
+    }
+    const source_file& add(const std::string& name, std::string text) {
+        return m_files.emplace_back(static_cast<std::uint32_t>(m_files.size()), name, std::move(text));
+    }
+    const source_file& operator[](std::uint32_t id) const {
+        return m_files[id];
+    }
+
+   private:
+    std::deque<source_file> m_files;
 };
 }  // namespace skai
 #endif
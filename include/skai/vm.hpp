@@ -0,0 +1,589 @@
+#ifndef SKAI_VM_HPP_1930EIEOEP383
+#define SKAI_VM_HPP_1930EIEOEP383
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <skai/libs/builtins.hpp>
+#include <string>
+#include <vector>
+
+#include "bytecode.hpp"
+#include "error.hpp"
+#include "object.hpp"
+
+namespace skai {
+struct vm;
+namespace bytecode {
+// a captured variable, points into the vm stack while the variable is alive and owns the value once it goes out of
+// scope
+struct upvalue : object::container {
+    skai::object::value* location;
+    skai::object::value closed;
+
+    upvalue(skai::object::value* l) : location{l} {}
+
+    // an open upvalue points into the stack, which is traced by nobody
+    void trace(skai::object::tracer& t) override {
+        t(closed);
+    }
+    void clear() override {
+        closed = {};
+    }
+
+    std::string to_string() const override {
+        return "[upvalue]";
+    }
+    std::string type_to_string() const override {
+        return "upvalue";
+    }
+};
+
+struct closure : object::callable<vm> {
+    skai::object::ref<proto> fn;
+    std::vector<skai::object::ref<upvalue>> upvalues;
+
+    closure(const skai::object::ref<proto>& f) : fn{f}, upvalues(f->upvalues) {}
+
+    std::string to_string() const override {
+        return fn->to_string();
+    }
+    std::string type_to_string() const override {
+        return "function";
+    }
+    std::size_t mina() override {
+        return fn->min_arity;
+    }
+    std::size_t maxa() override {
+        return fn->arity;
+    }
+    bool variadic() const override {
+        return false;
+    }
+    skai::object::value call(vm& machine, const std::vector<skai::object::value>& args) override;
+
+    void trace(skai::object::tracer& t) override {
+        for (const auto& up : upvalues) t(up);
+    }
+    void clear() override {
+        upvalues.clear();
+    }
+};
+}  // namespace bytecode
+
+struct vm : object::invoker {
+    static constexpr std::size_t max_frames = 1024;
+    static constexpr std::size_t max_stack = max_frames * 64;
+
+    vm() : m_stack(max_stack) {
+        m_globals.define("print", object::make<builtins::print<vm>>());
+        m_globals.define("prompt", object::make<builtins::prompt<vm>>());
+        m_globals.define("random", object::make<builtins::random<vm>>());
+        m_globals.define("time", object::make<builtins::time<vm>>());
+        m_globals.define("sleep", object::make<builtins::sleep<vm>>());
+        m_globals.define("type_of", object::make<builtins::type_of<vm>>());
+        m_globals.define("len", object::make<builtins::len<vm>>());
+        m_globals.define("contains", object::make<builtins::contains<vm>>());
+        m_globals.define("remove", object::make<builtins::remove<vm>>());
+        m_globals.define("gc", object::make<builtins::gc<vm>>());
+        m_frames.reserve(max_frames);
+        m_sp = m_stack.data();
+    }
+
+    bytecode::global_table& globals() {
+        return m_globals;
+    }
+    // binary operator sites rewritten into a typed form, and typed sites that saw other types and went back
+    std::size_t quickened() const {
+        return m_quickened;
+    }
+    std::size_t deoptimized() const {
+        return m_deoptimized;
+    }
+
+    void interpret(const object::ref<bytecode::proto>& script) {
+        auto fn = object::make<bytecode::closure>(script);
+        m_reserve(1);
+        m_push(fn);
+        m_call_closure(fn.get(), 0);
+        m_run(m_frames.size() - 1);
+        m_pop();
+    }
+
+    // calls a compiled function from native code, runs a nested dispatch loop until the function returns
+    object::value call(bytecode::closure* fn, const std::vector<object::value>& args) {
+        return call(fn, args.data(), args.size());
+    }
+    object::value call(bytecode::closure* fn, const object::value* args, std::size_t argc) {
+        auto depth = m_frames.size();
+        m_reserve(argc + 1);
+        m_push(object::value{});
+        for (std::size_t i = 0; i < argc; ++i) m_push(args[i]);
+        m_call_closure(fn, argc);
+        m_run(depth);
+        return m_pop();
+    }
+    // script functions called from native code
+    object::value invoke(const object::value& fn, const object::value* args, std::size_t argc) override {
+        if (auto closure = fn.as<bytecode::closure>()) return call(closure, args, argc);
+        if (auto native = fn.as<object::callable<vm>>()) {
+            object::check_arity(*native, argc);
+            return native->call(*this, std::vector<object::value>(args, args + argc));
+        }
+        throw skai::exception{"cannot perfrom call operation on a non-callable object"};
+    }
+
+   private:
+    using value_t = object::value;
+    using opcode = bytecode::opcode;
+
+    struct frame {
+        bytecode::closure* fn;
+        // code is rewritten in place by quickening
+        std::uint8_t* ip;
+        value_t* slots;
+    };
+
+    void m_push(value_t v) {
+        *m_sp++ = std::move(v);
+    }
+    value_t m_pop() {
+        return std::move(*--m_sp);
+    }
+
+    // pushes aren't checked, whatever pushes has to make sure there is room for 'count' more values first
+    void m_reserve(std::size_t count) {
+        if (static_cast<std::size_t>(m_stack.data() + m_stack.size() - m_sp) < count)
+            throw skai::exception{"stack overflow"};
+    }
+
+    // pushes a new frame for 'fn', the callee and its 'argc' arguments are already on the stack. the frame gets all
+    // the room its body can use, missing arguments included
+    void m_call_closure(bytecode::closure* fn, std::size_t argc) {
+        if (m_frames.size() >= max_frames) throw skai::exception{"stack overflow"};
+        object::check_arity(*fn, argc);
+        m_reserve(fn->fn->max_stack);
+        for (; argc < fn->fn->arity; ++argc) m_push(value_t::undefined());
+        m_frames.push_back(frame{fn, fn->fn->code.code.data(), m_sp - argc - 1});
+    }
+
+    void m_call_value(std::size_t argc) {
+        auto& callee = m_sp[-1 - static_cast<std::ptrdiff_t>(argc)];
+        if (auto fn = callee.as<bytecode::closure>()) return m_call_closure(fn, argc);
+        if (auto fn = callee.as<object::callable<vm>>()) {
+            object::check_arity(*fn, argc);
+            std::vector<value_t> args(m_sp - argc, m_sp);
+            auto result = fn->call(*this, args);
+            for (std::size_t i = 0; i <= argc; ++i) m_pop();
+            return m_push(std::move(result));
+        }
+        throw skai::exception{"cannot perfrom call operation on a non-callable object"};
+    }
+
+    object::ref<bytecode::upvalue> m_capture(value_t* local) {
+        for (auto it = m_open_upvalues.rbegin(); it != m_open_upvalues.rend(); ++it) {
+            if ((*it)->location == local) return *it;
+            if ((*it)->location < local) break;
+        }
+        auto up = object::make<bytecode::upvalue>(local);
+        auto pos = std::find_if(m_open_upvalues.begin(), m_open_upvalues.end(),
+                                [&](const auto& u) { return u->location > local; });
+        m_open_upvalues.insert(pos, up);
+        return up;
+    }
+    void m_close_upvalues(value_t* last) {
+        while (!m_open_upvalues.empty() && m_open_upvalues.back()->location >= last) {
+            auto& up = m_open_upvalues.back();
+            up->closed = *up->location;
+            up->location = &up->closed;
+            m_open_upvalues.pop_back();
+        }
+    }
+
+    static bool m_to_bool(const value_t& obj) {
+        if (obj.is_null()) {
+            return false;
+        } else if (obj.is_bool()) {
+            return obj.as_bool();
+        }
+        throw skai::exception{"implicit conversions to booleans are disallowed"};
+    }
+
+    // checks and operations of the quickened handlers, the operator is a constant in each of them so the switches fold
+    // away
+    static bool m_ints(const value_t& lhs, const value_t& rhs) {
+        return lhs.is_int() && rhs.is_int();
+    }
+    static bool m_floats(const value_t& lhs, const value_t& rhs) {
+        return lhs.is_float() && rhs.is_float();
+    }
+    static bool m_strings(const value_t& lhs, const value_t& rhs) {
+        return lhs.id() == object::type_id::string && rhs.id() == object::type_id::string;
+    }
+    static void m_int(token op, value_t& lhs, const value_t& rhs) {
+        lhs = object::int_binary(op, lhs.as_int(), rhs.as_int());
+    }
+    static void m_float(token op, value_t& lhs, const value_t& rhs) {
+        lhs = object::float_binary(op, lhs.as_float(), rhs.as_float());
+    }
+    template <token Op>
+    static void m_string(token, value_t& lhs, const value_t& rhs) {
+        if (Op == token::plus && object::append_in_place(lhs, rhs)) return;
+        lhs = object::string_string<Op>(Op, lhs, rhs);
+    }
+
+    // 'counter' follows a generic binary operator whose operands are on top of the stack
+    void m_quicken(std::uint8_t* counter) {
+        auto op = static_cast<opcode>(counter[-1]);
+        auto id = m_sp[-2].id();
+        auto quick = id == m_sp[-1].id() ? bytecode::quickened(op, id) : op;
+        if (quick == op) {
+            *counter = bytecode::quicken_backoff;
+            return;
+        }
+        counter[-1] = static_cast<std::uint8_t>(quick);
+        ++m_quickened;
+    }
+    void m_deoptimize(std::uint8_t* site) {
+        *site = static_cast<std::uint8_t>(bytecode::generic(static_cast<opcode>(*site)));
+        site[1] = bytecode::quicken_backoff;
+        ++m_deoptimized;
+    }
+
+    void m_run(std::size_t exit_depth) {
+        auto* fr = &m_frames.back();
+        auto* ip = fr->ip;
+        auto* constants = fr->fn->fn->code.constants.data();
+
+        auto read_u8 = [&] { return *ip++; };
+        auto read_u16 = [&] {
+            ip += 2;
+            return static_cast<std::uint16_t>(ip[-2] | (ip[-1] << 8));
+        };
+
+// generic binary operators count down to quickening, the counter is the byte that follows the opcode
+#define SK_BINARY(tok)                                          \
+    {                                                           \
+        if (--*ip == 0) m_quicken(ip);                          \
+        ++ip;                                                   \
+        auto right = m_pop();                                   \
+        object::binary_assign(token::tok, m_sp[-1], right);     \
+        break;                                                  \
+    }
+// a quickened operator whose operands fail the check goes back to the generic one, which runs right away
+#define SK_QUICK(tok, check, fn)                       \
+    {                                                  \
+        if (!check(m_sp[-2], m_sp[-1])) {              \
+            m_deoptimize(--ip);                        \
+            break;                                     \
+        }                                              \
+        ++ip;                                          \
+        fn(token::tok, m_sp[-2], m_sp[-1]);            \
+        m_pop();                                       \
+        break;                                         \
+    }
+
+        while (true) {
+            switch (static_cast<opcode>(read_u8())) {
+                case opcode::constant:
+                    m_push(constants[read_u16()]);
+                    break;
+                case opcode::null:
+                    m_push(value_t{});
+                    break;
+                case opcode::true_:
+                    m_push(value_t::boolean(true));
+                    break;
+                case opcode::false_:
+                    m_push(value_t::boolean(false));
+                    break;
+                case opcode::pop:
+                    m_pop();
+                    break;
+                case opcode::get_local:
+                    m_push(fr->slots[read_u8()]);
+                    break;
+                case opcode::set_local:
+                    fr->slots[read_u8()] = m_sp[-1];
+                    break;
+                case opcode::compound_local: {
+                    auto& slot = fr->slots[read_u8()];
+                    object::binary_assign(static_cast<token>(read_u8()), slot, m_sp[-1]);
+                    m_sp[-1] = slot;
+                    break;
+                }
+                case opcode::compound_global: {
+                    auto idx = read_u16();
+                    auto op = static_cast<token>(read_u8());
+                    auto& slot = m_globals.target(idx);
+                    object::binary_assign(op, slot, m_sp[-1]);
+                    m_sp[-1] = slot;
+                    break;
+                }
+                case opcode::compound_upvalue: {
+                    auto& slot = *fr->fn->upvalues[read_u8()]->location;
+                    object::binary_assign(static_cast<token>(read_u8()), slot, m_sp[-1]);
+                    m_sp[-1] = slot;
+                    break;
+                }
+                case opcode::get_global:
+                    m_push(m_globals.get(read_u16()));
+                    break;
+                case opcode::set_global:
+                    m_globals.assign(read_u16(), m_sp[-1]);
+                    break;
+                case opcode::define_global: {
+                    auto idx = read_u16();
+                    m_globals.is_const[idx] = read_u8();
+                    m_globals.values[idx] = m_pop();
+                    break;
+                }
+                case opcode::get_upvalue:
+                    m_push(*fr->fn->upvalues[read_u8()]->location);
+                    break;
+                case opcode::set_upvalue:
+                    *fr->fn->upvalues[read_u8()]->location = m_sp[-1];
+                    break;
+                case opcode::close_upvalue:
+                    m_close_upvalues(m_sp - 1);
+                    m_pop();
+                    break;
+                case opcode::add:
+                    SK_BINARY(plus)
+                case opcode::sub:
+                    SK_BINARY(minus)
+                case opcode::mul:
+                    SK_BINARY(star)
+                case opcode::div:
+                    SK_BINARY(slash)
+                case opcode::mod:
+                    SK_BINARY(mod)
+                case opcode::b_and:
+                    SK_BINARY(b_and)
+                case opcode::b_or:
+                    SK_BINARY(b_or)
+                case opcode::xor_:
+                    SK_BINARY(xor_)
+                case opcode::lshift:
+                    SK_BINARY(lshift)
+                case opcode::rshift:
+                    SK_BINARY(rshift)
+                case opcode::eq:
+                    SK_BINARY(d_eq)
+                case opcode::not_eq_:
+                    SK_BINARY(not_eq_)
+                case opcode::lt:
+                    SK_BINARY(lt)
+                case opcode::lt_eq:
+                    SK_BINARY(lt_eq)
+                case opcode::gt:
+                    SK_BINARY(gt)
+                case opcode::gt_eq:
+                    SK_BINARY(gt_eq)
+                case opcode::add_ii:
+                    SK_QUICK(plus, m_ints, m_int)
+                case opcode::sub_ii:
+                    SK_QUICK(minus, m_ints, m_int)
+                case opcode::mul_ii:
+                    SK_QUICK(star, m_ints, m_int)
+                case opcode::mod_ii:
+                    SK_QUICK(mod, m_ints, m_int)
+                case opcode::eq_ii:
+                    SK_QUICK(d_eq, m_ints, m_int)
+                case opcode::not_eq_ii:
+                    SK_QUICK(not_eq_, m_ints, m_int)
+                case opcode::lt_ii:
+                    SK_QUICK(lt, m_ints, m_int)
+                case opcode::lt_eq_ii:
+                    SK_QUICK(lt_eq, m_ints, m_int)
+                case opcode::gt_ii:
+                    SK_QUICK(gt, m_ints, m_int)
+                case opcode::gt_eq_ii:
+                    SK_QUICK(gt_eq, m_ints, m_int)
+                case opcode::add_ff:
+                    SK_QUICK(plus, m_floats, m_float)
+                case opcode::sub_ff:
+                    SK_QUICK(minus, m_floats, m_float)
+                case opcode::mul_ff:
+                    SK_QUICK(star, m_floats, m_float)
+                case opcode::div_ff:
+                    SK_QUICK(slash, m_floats, m_float)
+                case opcode::lt_ff:
+                    SK_QUICK(lt, m_floats, m_float)
+                case opcode::lt_eq_ff:
+                    SK_QUICK(lt_eq, m_floats, m_float)
+                case opcode::gt_ff:
+                    SK_QUICK(gt, m_floats, m_float)
+                case opcode::gt_eq_ff:
+                    SK_QUICK(gt_eq, m_floats, m_float)
+                case opcode::add_ss:
+                    SK_QUICK(plus, m_strings, m_string<token::plus>)
+                case opcode::eq_ss:
+                    SK_QUICK(d_eq, m_strings, m_string<token::d_eq>)
+                case opcode::not_: {
+                    if (!m_sp[-1].is_bool()) throw skai::exception{"invalid operand for token '!'"};
+                    m_sp[-1] = value_t::boolean(!m_sp[-1].as_bool());
+                    break;
+                }
+                case opcode::negate:
+                case opcode::plus: {
+                    bool neg = ip[-1] == static_cast<std::uint8_t>(opcode::negate);
+                    auto& target = m_sp[-1];
+                    if (target.is_int()) {
+                        if (neg) target = value_t::integer(object::checked(token::minus, 0, target.as_int()));
+                    } else if (target.is_float()) {
+                        if (neg) target = value_t::floating(-target.as_float());
+                    } else {
+                        throw skai::exception{fmt::format("invalid operand for token '{}'", neg ? '-' : '+')};
+                    }
+                    break;
+                }
+                case opcode::to_bool:
+                    m_sp[-1] = value_t::boolean(m_to_bool(m_sp[-1]));
+                    break;
+                case opcode::jump: {
+                    auto offset = read_u16();
+                    ip += offset;
+                    break;
+                }
+                case opcode::jump_if_false: {
+                    auto offset = read_u16();
+                    if (!m_to_bool(m_pop())) ip += offset;
+                    break;
+                }
+                case opcode::jump_if_bound: {
+                    auto slot = read_u8();
+                    auto offset = read_u16();
+                    if (!fr->slots[slot].is_undefined()) ip += offset;
+                    break;
+                }
+                case opcode::iterate: {
+                    auto* slots = fr->slots + read_u8();
+                    auto offset = read_u16();
+                    auto cursor = slots[1].as_int();
+                    if (!object::next(slots[0], cursor, slots[2])) {
+                        ip += offset;
+                        break;
+                    }
+                    slots[1] = value_t::integer(cursor);
+                    break;
+                }
+                case opcode::loop: {
+                    auto offset = read_u16();
+                    ip -= offset;
+                    break;
+                }
+                case opcode::call: {
+                    auto argc = read_u8();
+                    fr->ip = ip;
+                    m_call_value(argc);
+                    fr = &m_frames.back();
+                    ip = fr->ip;
+                    constants = fr->fn->fn->code.constants.data();
+                    break;
+                }
+                case opcode::closure: {
+                    auto fn = object::ref<bytecode::proto>{static_cast<bytecode::proto*>(constants[read_u16()].as_object())};
+                    auto cl = object::make<bytecode::closure>(fn);
+                    for (auto& up : cl->upvalues) {
+                        auto is_local = read_u8();
+                        auto index = read_u8();
+                        up = is_local ? m_capture(fr->slots + index) : fr->fn->upvalues[index];
+                    }
+                    m_push(std::move(cl));
+                    break;
+                }
+                case opcode::return_: {
+                    auto result = m_pop();
+                    m_close_upvalues(fr->slots);
+                    while (m_sp > fr->slots) m_pop();
+                    m_frames.pop_back();
+                    m_push(std::move(result));
+                    if (m_frames.size() == exit_depth) return;
+                    fr = &m_frames.back();
+                    ip = fr->ip;
+                    constants = fr->fn->fn->code.constants.data();
+                    break;
+                }
+                case opcode::array: {
+                    auto count = read_u16();
+                    std::vector<value_t> values(std::make_move_iterator(m_sp - count), std::make_move_iterator(m_sp));
+                    m_sp -= count;
+                    m_push(object::make<object::array>(std::move(values)));
+                    break;
+                }
+                case opcode::range: {
+                    auto step = m_pop();
+                    auto end = m_pop();
+                    m_sp[-1] = object::make<object::range>(m_sp[-1], end, step);
+                    break;
+                }
+                case opcode::dict: {
+                    auto count = read_u16();
+                    auto map = object::make<object::dict>();
+                    for (auto* entry = m_sp - 2 * count; entry != m_sp; entry += 2) map->set(entry[0], entry[1]);
+                    for (std::size_t i = 0; i < 2u * count; ++i) m_pop();
+                    m_push(std::move(map));
+                    break;
+                }
+                case opcode::interpolate: {
+                    auto count = read_u16();
+                    auto result = object::interpolate(m_sp - count, count);
+                    while (count--) m_pop();
+                    m_push(std::move(result));
+                    break;
+                }
+                case opcode::slice: {
+                    auto end = m_pop();
+                    auto begin = m_pop();
+                    if (!m_sp[-1].is_object())
+                        throw skai::exception{fmt::format("'{}' can't be sliced", m_sp[-1].type_to_string())};
+                    m_sp[-1] = m_sp[-1].as_object()->slice(begin, end);
+                    break;
+                }
+                case opcode::invoke: {
+                    auto name = static_cast<object::string*>(constants[read_u16()].as_object())->view();
+                    auto argc = read_u8();
+                    auto result = object::call_method(m_sp[-1 - argc], name, m_sp - argc, argc, *this);
+                    for (std::size_t i = 0; i <= argc; ++i) m_pop();
+                    m_push(std::move(result));
+                    break;
+                }
+                case opcode::subscript: {
+                    auto idx = m_pop();
+                    if (!m_sp[-1].is_object())
+                        throw skai::exception{fmt::format("'{}' is not subscriptable", m_sp[-1].type_to_string())};
+                    m_sp[-1] = m_sp[-1].as_object()->subscript(idx);
+                    break;
+                }
+                case opcode::set_subscript: {
+                    auto val = m_pop();
+                    auto idx = m_pop();
+                    if (!m_sp[-1].is_object())
+                        throw skai::exception{
+                            fmt::format("'{}' does not support item assignment", m_sp[-1].type_to_string())};
+                    m_sp[-1].as_object()->set_subscript(idx, val);
+                    m_sp[-1] = std::move(val);
+                    break;
+                }
+            }
+        }
+#undef SK_BINARY
+#undef SK_QUICK
+    }
+
+    std::vector<value_t> m_stack;
+    value_t* m_sp;
+    std::vector<frame> m_frames;
+    std::vector<object::ref<bytecode::upvalue>> m_open_upvalues;
+    bytecode::global_table m_globals;
+    std::size_t m_quickened = 0;
+    std::size_t m_deoptimized = 0;
+};
+
+inline object::value bytecode::closure::call(vm& machine, const std::vector<skai::object::value>& args) {
+    return machine.call(this, args);
+}
+}  // namespace skai
+#endif
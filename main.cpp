@@ -1,27 +1,110 @@
-#include <fstream>
+#include <chrono>
+#include <cstdlib>
 #include <fmt/core.h>
+#include <skai/compiler.hpp>
 #include <skai/interpreter.hpp>
 #include <skai/lexer.hpp>
+#include <skai/optimizer.hpp>
 #include <skai/parser.hpp>
+#include <skai/resolver.hpp>
+#include <skai/vm.hpp>
 #include <string>
 
-int main(int, char** argv) {
+int main(int argc, char** argv) {
     std::string input;
     std::string filename;
-    if (std::string{argv[1]} == "-e") {
-        input = argv[2];
-        filename = "argv";
-    } else {
-        std::ifstream file{argv[1]};
-        filename = argv[1];
-        std::string tmp;
-        while (std::getline(file, tmp)) (input += tmp) += '\n';
+    bool inline_code = false;
+    // the bytecode vm is the default backend, '--walk' selects the tree walking interpreter which is kept as a reference
+    bool walk = false;
+    // '--stats' reports timings and interpreter counters on stderr once the script is done
+    bool stats = false;
+    // '--no-opt' runs the ast as parsed, for debugging the optimizer
+    bool optimize = true;
+    // '--gc-threshold <n>' sets how many containers are allocated between two collections of the young generation, 0
+    // leaves collecting to 'gc()'
+    auto& cycles = skai::object::cycles;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg{argv[i]};
+        if (arg == "--walk") {
+            walk = true;
+        } else if (arg == "--vm") {
+            walk = false;
+        } else if (arg == "--stats") {
+            stats = true;
+        } else if (arg == "--no-opt") {
+            optimize = false;
+        } else if (arg == "--gc-threshold" && i + 1 < argc) {
+            cycles.threshold = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "-e" && i + 1 < argc) {
+            input = argv[++i];
+            filename = "argv";
+            inline_code = true;
+        } else {
+            filename = arg;
+            inline_code = false;
+        }
     }
+    if (filename.empty()) {
+        fmt::print("usage: {} [--vm | --walk] [--stats] [--no-opt] [--gc-threshold <n>] (-e <code> | <file>)\n",
+                   argv[0]);
+        return 1;
+    }
+    using clock = std::chrono::steady_clock;
+    auto elapsed = [](clock::time_point since) {
+        return std::chrono::duration<double, std::milli>(clock::now() - since).count();
+    };
+    auto heap = [&] {
+        using ms = std::chrono::duration<double, std::milli>;
+        fmt::print(stderr, "objects: {} allocated, {} alive\n", skai::object::heap.allocated, skai::object::heap.alive);
+        fmt::print(stderr, "gc: {} collections ({} full), {} freed, pause {:.3f}ms total, {:.3f}ms max\n",
+                   cycles.collections, cycles.full_collections, cycles.freed, ms(cycles.total_pause).count(),
+                   ms(cycles.max_pause).count());
+        auto& pools = skai::object::pools;
+        fmt::print(stderr, "pools: {} allocations pooled, {} from malloc, {} slabs ({} KiB)\n", pools.pooled,
+                   pools.malloced, pools.slabs, pools.slabs * pools.slab_size / 1024);
+    };
     try {
-        skai::lexer lexer{input, filename};
-        skai::parser parse{lexer.lex(), filename};
-        skai::interpreter inter;
+        auto start = clock::now();
+        // scripts are mapped into memory, tokens and diagnostics refer to them by offset
+        skai::sources files;
+        const auto& src = inline_code ? files.add(filename, std::move(input)) : files.open(filename);
+        if (!src.ok()) throw skai::exception{fmt::format("can't open file '{}'", filename)};
+        skai::lexer lexer{src};
+        skai::parser parse{lexer.lex(), src};
         auto o = parse.parse();
-        inter.interpret(o);
+        auto parse_ms = elapsed(start);
+        auto parse_mbs = parse_ms > 0 ? static_cast<double>(src.text().size()) / 1e3 / parse_ms : 0.0;
+        skai::optimizer opt;
+        if (optimize) opt.optimize(o);
+        if (stats && optimize)
+            fmt::print(stderr, "optimizer: {} folded, {} propagated, {} removed\n", opt.folded(), opt.propagated(),
+                       opt.removed());
+        if (walk) {
+            skai::interpreter inter;
+            skai::resolver res{inter.globals()};
+            auto script = res.resolve(o);
+            start = clock::now();
+            inter.interpret(o, script);
+            auto run_ms = elapsed(start);
+            if (stats) {
+                auto nodes = inter.nodes_evaluated();
+                fmt::print(stderr, "parse: {:.3f}ms ({:.1f}MB/s)\nast: {} bytes\nrun: {:.3f}ms\nnodes evaluated: {}\n",
+                           parse_ms, parse_mbs, o.bytes(), run_ms, nodes);
+                fmt::print(stderr, "ns per node: {:.2f}\n", nodes ? run_ms * 1e6 / static_cast<double>(nodes) : 0.0);
+                heap();
+            }
+        } else {
+            skai::vm machine;
+            skai::compiler comp{machine.globals()};
+            auto script = comp.compile(o);
+            start = clock::now();
+            machine.interpret(script);
+            if (stats) {
+                fmt::print(stderr, "parse: {:.3f}ms ({:.1f}MB/s)\nast: {} bytes\nrun: {:.3f}ms\n", parse_ms, parse_mbs,
+                           o.bytes(), elapsed(start));
+                fmt::print(stderr, "quickened: {} sites, {} deoptimized\n", machine.quickened(), machine.deoptimized());
+                heap();
+            }
+        }
     } catch (skai::exception& exc) { fmt::print("{}\n", exc.msg); }
 }
@@ -0,0 +1,6 @@
+# runs SCRIPT with both backends of MAIN and fails unless they print the same thing
+execute_process(COMMAND ${MAIN} --vm ${SCRIPT} OUTPUT_VARIABLE vm ERROR_VARIABLE vm)
+execute_process(COMMAND ${MAIN} --walk ${SCRIPT} OUTPUT_VARIABLE walk ERROR_VARIABLE walk)
+if(NOT vm STREQUAL walk)
+    message(FATAL_ERROR "backends disagree on ${SCRIPT}\n--vm:\n${vm}\n--walk:\n${walk}")
+endif()